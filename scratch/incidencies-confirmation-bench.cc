@@ -0,0 +1,223 @@
+/*
+ * incidencies-confirmation-bench.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+/*
+ * Measures what a confirmation costs an IncidentGenerator. A generator on a
+ * two-node network broadcasts one incident and is then handed 'n'
+ * confirmations from 'confirmers' distinct addresses, the way the oracle
+ * delivers them. The cost of the Node -> Ipv4 -> address lookup the
+ * applications used to do for every packet is timed alongside; before the
+ * address was cached, a confirmation logged with events=1 paid it on top.
+ *
+ * With legacy=1 the confirmations are '#'-delimited text datagrams sent by
+ * the second node, so they go through the stack and HandleConfirmations.
+ * They carry selfishness 1 and are all discarded, so the generator keeps
+ * nothing per confirmation and its memory must stay flat: the run fails if
+ * the resident size grows by more than 'maxGrowth' KiB after the first
+ * tenth of the confirmations.
+ *
+ * All confirmations are handed over at the same simulated time, so the
+ * confirmation timer never fires during the run.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+
+#include <cstdio>
+#include <iostream>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+static double
+WallTime (void)
+{
+	struct timeval tv;
+	gettimeofday (&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/*
+ * \returns the resident set size of the process, in KiB
+ */
+static uint64_t
+ResidentSize (void)
+{
+	FILE *f = fopen ("/proc/self/statm", "r");
+	if ( f == 0 ) return 0;
+
+	unsigned long size = 0, resident = 0;
+	if ( fscanf (f, "%lu %lu", &size, &resident) != 2 ) resident = 0;
+	fclose (f);
+	return (uint64_t) resident * sysconf (_SC_PAGESIZE) / 1024;
+}
+
+static double g_confirmationTime = 0.;
+static double g_start = 0.;
+static uint64_t g_warmResident = 0;
+static uint64_t g_endResident = 0;
+
+static void
+Confirm (Ptr<IncidentGenerator> generator, uint32_t n, uint32_t confirmers)
+{
+	uint32_t base = Ipv4Address ("10.2.0.1").Get ();
+
+	double start = WallTime ();
+	for ( uint32_t i = 0; i < n; i++ )
+	{
+		generator->ProcessConfirmation (InetSocketAddress (Ipv4Address (base + i % confirmers), 8089),
+				0.5, 0., 0, 512);
+	}
+	g_confirmationTime = WallTime () - start;
+}
+
+/*
+ * Sends legacy confirmation 'i' of 'n' to 'to' and schedules the next one
+ * behind its delivery, so only one is in flight at a time.
+ */
+static void
+SendLegacyConfirmation (Ptr<Socket> socket, Address to, uint32_t i, uint32_t n)
+{
+	if ( i == n / 10 ) g_warmResident = ResidentSize ();
+	if ( i == n )
+	{
+		g_confirmationTime = WallTime () - g_start;
+		g_endResident = ResidentSize ();
+		return;
+	}
+
+	static const char text[] = "0.5#1#";
+	socket->SendTo (Create<Packet> (reinterpret_cast<const uint8_t *> (text), sizeof (text) - 1), 0, to);
+	Simulator::ScheduleNow (&SendLegacyConfirmation, socket, to, i + 1, n);
+}
+
+/*
+ * The incident broadcast tells us where the generator expects its
+ * confirmations.
+ */
+static void
+ReceiveBroadcast (uint32_t n, Ptr<Socket> socket)
+{
+	Address from;
+	while ( socket->RecvFrom (from) ) {}
+
+	g_start = WallTime ();
+	Simulator::ScheduleNow (&SendLegacyConfirmation, socket, from, 0, n);
+}
+
+int main (int argc, char *argv[])
+{
+	uint32_t	n = 1000000;
+	uint32_t	confirmers = 64;
+	uint32_t	events = 0;
+	uint32_t	legacy = 0;
+	uint32_t	maxGrowth = 1024;
+
+	CommandLine cmd;
+	cmd.AddValue ("n", "Confirmations to process", n);
+	cmd.AddValue ("confirmers", "Distinct addresses the confirmations come from", confirmers);
+	cmd.AddValue ("events", "Record CONF_RCVD events (in memory)", events);
+	cmd.AddValue ("legacy", "Send text confirmations through the sockets and check memory", legacy);
+	cmd.AddValue ("maxGrowth", "Resident size growth allowed with legacy=1, in KiB", maxGrowth);
+	cmd.Parse (argc, argv);
+
+	if ( n == 0 ) n = 1;
+	if ( confirmers == 0 ) confirmers = 1;
+	if ( events == 1 ) IncidentEventLog::SetMask (1 << IncidentEvent::CONF_RCVD);
+
+	NodeContainer nodes;
+	nodes.Create (2);
+
+	Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+	for ( uint32_t i = 0; i < nodes.GetN (); i++ )
+	{
+		Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+		device->SetAddress (Mac48Address::Allocate ());
+		device->SetChannel (channel);
+		nodes.Get (i)->AddDevice (device);
+	}
+
+	InternetStackHelper internet;
+	internet.Install (nodes);
+
+	NetDeviceContainer devices;
+	devices.Add (nodes.Get (0)->GetDevice (0));
+	devices.Add (nodes.Get (1)->GetDevice (0));
+	Ipv4AddressHelper ipv4;
+	ipv4.SetBase ("10.1.0.0", "255.255.0.0");
+	ipv4.Assign (devices);
+
+	IncidentGeneratorHelper generatorHelper (8089);
+	generatorHelper.SetAttribute ("TimerDelay", TimeValue (Seconds (100)));
+	generatorHelper.SetAttribute ("LegacyConfirmationFormat", BooleanValue (legacy == 1));
+	ApplicationContainer apps = generatorHelper.Install (nodes.Get (0));
+	apps.Start (Seconds (0.));
+	Ptr<IncidentGenerator> generator = DynamicCast<IncidentGenerator> (apps.Get (0));
+
+	generator->GenerateNewIncident (Seconds (1.));
+	if ( legacy == 1 )
+	{
+		Ptr<Socket> socket = Socket::CreateSocket (nodes.Get (1), UdpSocketFactory::GetTypeId ());
+		socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), 8089));
+		socket->SetRecvCallback (MakeBoundCallback (&ReceiveBroadcast, n));
+	}
+	else
+	{
+		Simulator::Schedule (Seconds (1.), &Confirm, generator, n, confirmers);
+	}
+	Simulator::Stop (Seconds (2.));
+	Simulator::Run ();
+
+	// The per-packet lookup the applications no longer do
+	Ptr<Node> node = nodes.Get (0);
+	uint32_t check = 0;
+	double start = WallTime ();
+	for ( uint32_t i = 0; i < n; i++ )
+	{
+		check += node->GetId ();
+		check += node->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ().Get ();
+	}
+	double lookupTime = WallTime () - start;
+
+	if ( legacy == 1 ) std::cout << "legacy confirmations: " << n;
+	else std::cout << "confirmations: " << n << " from " << confirmers << " addresses";
+	std::cout << (events == 1 ? ", events recorded" : "") << "\n";
+	std::cout << "per confirmation: " << g_confirmationTime / n * 1e9 << " ns\n";
+	std::cout << "per address lookup: " << lookupTime / n * 1e9 << " ns (checksum " << check << ")\n";
+
+	Simulator::Destroy ();
+
+	if ( legacy == 1 )
+	{
+		int64_t growth = (int64_t) g_endResident - (int64_t) g_warmResident;
+		std::cout << "resident size: " << g_warmResident << " KiB after " << n / 10 << " confirmations, "
+				<< g_endResident << " KiB after " << n << "\n";
+		if ( g_endResident == 0 || growth > (int64_t) maxGrowth )
+		{
+			std::cerr << "FAIL: resident size grew by " << growth << " KiB (limit " << maxGrowth << ")" << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * incidencies-event-decoder.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+/*
+ * Converts a binary event log (eventLog parameter of the simulations) back
+ * to the [GEN_INC], [CONF_RCVD], [STATS], ... lines the applications used
+ * to log.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/applications-module.h"
+
+#include <fstream>
+#include <iostream>
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+	std::string		inputFile;
+	std::string		outputFile;
+
+	CommandLine cmd;
+	cmd.AddValue ("input", "Binary event log", inputFile);
+	cmd.AddValue ("output", "Text file to write (standard output if empty)", outputFile);
+	cmd.Parse (argc, argv);
+
+	std::ofstream file;
+	if ( !outputFile.empty () ) file.open (outputFile.c_str ());
+	std::ostream &os = outputFile.empty () ? std::cout : file;
+
+	if ( !IncidentEventLog::Decode (inputFile, os) )
+	{
+		std::cerr << "Unable to read event log " << inputFile << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
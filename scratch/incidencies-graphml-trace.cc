@@ -30,22 +30,28 @@
 #include "ns3/ns2-mobility-helper.h"
 #include "ns3/netanim-module.h"
 
-#define EVENT_TIME_INFO 2
-#define EVENT_NODE_INFO 3
-#define NODE_INFO_LENGTH 8				// Length of '$node_('
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("IncidenciesMobilityTrace");
 
-std::vector<double> currentReputationValues;
 double bias = .9;
-uint32_t	generatedEvents = 0;
+Ptr<UniformRandomVariable>	scenarioRandom;	// Node roles, trusted nodes and incident generators
 
 double
 RandomNumberUniform ()
 {
-	return drand48 ();
+	return scenarioRandom->GetValue ();
 }
 
 double
@@ -62,28 +68,10 @@ TossBiasedCoin (double bias)
 	return accept;
 }
 
-uint32_t
-GetNodeNumFromContext (std::string context)
-{
-	std::vector<std::string> elements;
-	std::stringstream ss (context);
-	std::string item;
-
-	while (std::getline (ss, item, '/')) {
-		elements.push_back (item);
-	}
-
-	std::stringstream toInteger (elements.at (2));
-	uint32_t nodeId;
-	toInteger >> nodeId;
-
-	return nodeId;
-}
-
 uint32_t
 GetRandomNode (int maxNodes)
 {
-	return (int) maxNodes * drand48 ();
+	return (int) maxNodes * RandomNumberUniform ();
 }
 
 void
@@ -125,16 +113,6 @@ SelectTrustedNodes (NodeContainer *n, double trustedNodes)
 	}
 }
 
-void
-ReputationValueTrace (std::string context, double oldValue, double newValue)
-{
-//	NS_LOG_INFO (Simulator::Now() << " " << context << " old reputation value or= " <<
-//			oldValue << ", new reputation value nr= " << newValue);
-
-//	NS_LOG_INFO (Simulator::Now ().GetSeconds () << " " << GetNodeNumFromContext (context) << " " << newValue);
-	currentReputationValues[GetNodeNumFromContext (context)] = newValue;
-}
-
 void
 CourseChange (std::string context, Ptr<const MobilityModel> model)
 {
@@ -143,21 +121,39 @@ CourseChange (std::string context, Ptr<const MobilityModel> model)
 }
 
 void
-DumpReputationValues (std::ostream *os, double nextDumpDelay)
+DumpReputationValues (Ptr<ReputationTraceWriter> writer, Ptr<ReputationMonitor> reputation,
+		Ptr<IncidentScheduler> incidents, double nextDumpDelay)
 {
-	std::stringstream dumpStream;
-	dumpStream << generatedEvents << ",";
-	for (unsigned int i = 0; i < currentReputationValues.size (); i++)
+	writer->WriteFrame (Simulator::Now (), incidents->GetGeneratedIncidents (), reputation->GetReputationValues ());
+	Simulator::Schedule (Seconds (nextDumpDelay), &DumpReputationValues, writer, reputation, incidents, nextDumpDelay);
+}
+
+/*
+ * Creates the reputation trace backend: 'csv' (default), 'binary' or
+ * 'changelog'.
+ */
+Ptr<ReputationTraceWriter>
+CreateReputationTraceWriter (std::string format, uint32_t precision, std::string compression,
+		uint32_t keyframeInterval)
+{
+	ObjectFactory factory;
+	if ( format == "binary" )
 	{
-		if ( i == (currentReputationValues.size () - 1) )
-			dumpStream << currentReputationValues.at (i);
-		else
-			dumpStream << currentReputationValues.at (i) << ",";
+		factory.SetTypeId ("ns3::BinaryReputationTraceWriter");
+		factory.Set ("Precision", UintegerValue (precision));
+		factory.Set ("Compression", StringValue (compression));
+	}
+	else if ( format == "changelog" )
+	{
+		factory.SetTypeId ("ns3::ChangeLogReputationTraceWriter");
+		factory.Set ("KeyframeInterval", UintegerValue (keyframeInterval));
+	}
+	else
+	{
+		factory.SetTypeId ("ns3::CsvReputationTraceWriter");
 	}
 
-//	NS_LOG_INFO (dumpStream.str ());
-	*os << dumpStream.str () << "\n";
-	Simulator::Schedule (Seconds (nextDumpDelay), &DumpReputationValues, os, nextDumpDelay);
+	return factory.Create<ReputationTraceWriter> ();
 }
 
 void
@@ -186,57 +182,46 @@ DumpNodeInfo (NodeContainer n, std::string filename)
 	networkTopology.close();
 }
 
-void
-DumpPosStatistics (std::ostream *os, NodeContainer container, uint32_t nodeId)
+/*
+ * Where the neighbourhood of every incident is dumped.
+ */
+struct PosStatisticsContext
 {
-	Ptr<Node> selectedNode = container.Get (nodeId);
-	Ptr<MobilityModel> mob = selectedNode->GetObject<MobilityModel> ();
-
-	std::stringstream dumpStream;
-	dumpStream << nodeId << "," << mob->GetPosition ().x << "," << mob->GetPosition ().y << ",";
-
-	for ( unsigned int i = 0; i < container.GetN (); i++ )
-	{
-		if ( i != nodeId )
-		{
-			Ptr<Node> current = container.Get (i);
-			mob = current->GetObject<MobilityModel> ();
-			if ( i == (container.GetN () - 1) ) {
-				dumpStream << mob->GetPosition ().x << "," << mob->GetPosition ().y;
-			}
-			else {
-				dumpStream << mob->GetPosition ().x << "," << mob->GetPosition ().y << ",";
-			}
-		}
-	}
-
-	*os << dumpStream.str () << "\n";
-}
+	Ptr<SpatialGridIndex>		grid;
+	const std::vector<uint8_t>	*roles;			// ReputationTraceWriter::NodeRole of every node
+	double						range;
+	std::ostream				*os;
+	std::vector<uint32_t>		neighbours;		// Reused between incidents
+};
 
+/*
+ * Writes 'nodeId,x,y,inRange,selfish,altruistic,malicious,random' followed
+ * by 'id,x,y' for every node within range of the node generating the
+ * incident.
+ */
 void
-NewEvent (NodeContainer container, double eventGenDelay)
+DumpPosStatistics (PosStatisticsContext *context, uint32_t incidentId, uint32_t nodeId)
 {
-	uint32_t genNode = GetRandomNode (container.GetN ());
-	Ptr<Node> selectedNode = container.Get (genNode);
-
-//	NS_LOG_INFO ("At time " << Simulator::Now() << " Node " << selectedNode->GetId () << " was selected.");
+	context->grid->GetNodesInRange (nodeId, context->range, context->neighbours);
+	const std::vector<uint32_t> &neighbours = context->neighbours;
 
-	Ptr<IncidentGenerator> genApp = selectedNode->GetApplication (1)->GetObject<IncidentGenerator> ();
-	genApp->GenerateNewIncident (Seconds (0.0));
-	generatedEvents++;
+	uint32_t roleCount[4] = { 0, 0, 0, 0 };
+	for ( unsigned int i = 0; i < neighbours.size (); i++ )
+	{
+		roleCount[(*context->roles)[neighbours[i]] & 3]++;
+	}
 
-	Simulator::Schedule(Seconds (eventGenDelay), &NewEvent, container, eventGenDelay);
-}
+	std::ostream &os = *context->os;
+	Vector position = context->grid->GetPosition (nodeId);
+	os << nodeId << "," << position.x << "," << position.y << "," << neighbours.size ();
+	for ( unsigned int r = 0; r < 4; r++ ) os << "," << roleCount[r];
 
-void
-AddEvent (NodeContainer container, uint32_t nodeId)
-{
-	Ptr<Node> selectedNode = container.Get (nodeId);
-	NS_LOG_INFO ("At time " << Simulator::Now().GetSeconds () << " Node " << nodeId << " was selected.");
-
-	Ptr<IncidentGenerator> genApp = selectedNode->GetApplication (1)->GetObject<IncidentGenerator> ();
-	genApp->GenerateNewIncident(Seconds (.0));
-	generatedEvents++;
+	for ( unsigned int i = 0; i < neighbours.size (); i++ )
+	{
+		position = context->grid->GetPosition (neighbours[i]);
+		os << "," << neighbours[i] << "," << position.x << "," << position.y;
+	}
+	os << "\n";
 }
 
 void
@@ -251,64 +236,305 @@ WifiPhyRxBeginTrace(std::string context, Ptr<const Packet> p)
 	NS_LOG_INFO ("INCIDENCIES_GRAPHML_TRACE::WifiPhyRxBeginTrace (" << context << ")");
 }
 
-int main (int argc, char *argv[])
+/*
+ * Simulation parameters, as read from the params file. The sweep driver
+ * overrides them per point using the same keys.
+ */
+struct SimulationParams
 {
-	// Enable logging from the ns2 helper
-	//LogComponentEnable ("Ns2MobilityHelper",LOG_LEVEL_DEBUG);
-	LogComponentEnable ("IncidenciesMobilityTrace", LOG_LEVEL_INFO);
-
-	std::string 	paramsFile;
-//	std::string		traceFilePath = "/home/cristian/apps/bonnmotion-2.0/mobility-traces";
 	std::string 	traceFile;
+	std::string		mobilityCacheFile;				// Compiled form of traceFile (see Ns2MobilityCache)
 	std::string		outputFile;
 	std::string		reputationTraceFile;
-	std::string		overrideReputationTraceFile;
+	std::string		reputationTraceFormat;			// csv or binary (see ReputationTraceWriter)
+	uint32_t		reputationTracePrecision;		// Bits per value of binary traces
+	std::string		reputationTraceCompression;		// None, Rle or Delta for binary traces
+	uint32_t		reputationKeyframeInterval;		// Frames between full keyframes of change logs
 	std::string		eventListFile;					// Fitxer que guarda la llista de totes les incidències generades
 	std::string 	posStatisticsFile;				// Fitxer que guarda informació estadística del posicionament dels nodes
-	uint32_t		numNodes = 100;
-	double			selfishNodesP = .25;
-	double			altruisticNodesP = .5;
-	double			maliciousNodesP = .1;
-	double			trustedNodes = .0;
-	double			initialReputationValue = .0;
-	double			duration = 100.;
-	double			waitForConfDelay = 1.;
-	uint32_t		validationMode = 0;
-	uint32_t		weightFunction = 21;
-	double			confirmationThreshold = 1.;
-	double			falseIncidentThreshold = 1.;
-	double			reputationThreshold = .9;
-	double			generatedIncWeight = 2.;
-	double			generationInterval = 3.;
-	double			wifiRange = 100.;
-	uint32_t		printNetworkTopology = 0;
+	uint32_t		numNodes;
+	double			selfishNodesP;
+	double			altruisticNodesP;
+	double			maliciousNodesP;
+	double			trustedNodes;
+	double			initialReputationValue;
+	double			duration;
+	double			waitForConfDelay;
+	uint32_t		validationMode;
+	uint32_t		weightFunction;
+	std::string		weightTable;					// (reputation, weight) points for weightFunction=24
+	double			confirmationThreshold;
+	double			falseIncidentThreshold;
+	double			reputationThreshold;
+	double			generatedIncWeight;
+	double			generationInterval;
+	double			wifiRange;
+	uint32_t		printNetworkTopology;
 	std::string		topologyFile;
-	uint32_t		printLogInfo = 0;
-	uint32_t		genAnimation = 0;
+	uint32_t		printLogInfo;
+	uint32_t		seed;
+	uint64_t		run;
+	uint32_t		genAnimation;
+	double			animStart;						// Animation window (s); animStop 0 for the end of the run
+	double			animStop;
+	int32_t			animIncident;					// Incident of the event list to centre the animation on, -1 for none
+	double			animMargin;						// Animation window (s) on each side of animIncident
+	double			animPollInterval;				// Time (s) between two animated positions of a node
+	uint32_t		animPacketMetadata;				// Include the packet metadata in the animation
+	uint32_t		eventWindow;					// Incidents of the event list kept in the event queue
+	double			maxSpeed;						// Highest node speed (m/s) for the grid, 0 to follow the nodes
+	std::string		deliveryMode;					// stack, or oracle to bypass the wifi stack (see IncidentOracle)
+	double			oracleDelay;					// Delivery delay (s) of the oracle messages
+	uint32_t		batchedUpdates;					// Broadcast one reputation update per incident
+	double			confirmationWindow;				// Sink confirmation batching window (s), 0 to disable
+	uint32_t		earlyDecision;					// Validate incidents as soon as the outcome is final
+	std::string		validator;						// IncidentValidator TypeId, overrides validationMode when set
+	std::string		eventLog;						// Binary event log (see incidencies-event-decoder)
+	uint32_t		eventMask;						// Events recorded, one bit per IncidentEvent::Kind
+	uint32_t		eventBuffer;					// Events buffered before writing them out
+	std::string		resourceLog;					// Resource samples (see ResourceMonitor), empty for none
+	double			resourceInterval;				// Simulated time (s) between resource samples
+	uint32_t		maxResidentSize;				// MiB above which the run is stopped, 0 for no limit
+	uint32_t		maxPendingIncidents;			// Pending incidents above which the run is stopped, 0 for no limit
+	double			maxEventRate;					// Events/s above which the run is stopped, 0 for no limit
+
+	SimulationParams ()
+		: reputationTraceFormat ("csv"),
+		  reputationTracePrecision (64),
+		  reputationTraceCompression ("None"),
+		  reputationKeyframeInterval (10),
+		  numNodes (100),
+		  selfishNodesP (.25),
+		  altruisticNodesP (.5),
+		  maliciousNodesP (.1),
+		  trustedNodes (.0),
+		  initialReputationValue (.0),
+		  duration (100.),
+		  waitForConfDelay (1.),
+		  validationMode (0),
+		  weightFunction (21),
+		  weightTable (""),
+		  confirmationThreshold (1.),
+		  falseIncidentThreshold (1.),
+		  reputationThreshold (.9),
+		  generatedIncWeight (2.),
+		  generationInterval (3.),
+		  wifiRange (100.),
+		  printNetworkTopology (0),
+		  printLogInfo (0),
+		  seed (1),
+		  run (1),
+		  genAnimation (0),
+		  animStart (0.),
+		  animStop (0.),
+		  animIncident (-1),
+		  animMargin (5.),
+		  animPollInterval (.25),
+		  animPacketMetadata (0),
+		  eventWindow (64),
+		  maxSpeed (0.),
+		  deliveryMode ("stack"),
+		  oracleDelay (.002),
+		  batchedUpdates (0),
+		  confirmationWindow (0.),
+		  earlyDecision (0),
+		  validator (""),
+		  eventLog (""),
+		  eventMask (IncidentEventLog::ALL),
+		  eventBuffer (4096),
+		  resourceLog (""),
+		  resourceInterval (10.),
+		  maxResidentSize (0),
+		  maxPendingIncidents (0),
+		  maxEventRate (0.)
+	{
+	}
+};
 
-	srand48 (time (0));
+/*
+ * Sets the parameter 'paramName' to 'paramValue'. Returns false if the key
+ * is unknown.
+ */
+bool
+SetParam (SimulationParams &p, const std::string &paramName, const std::string &paramValue)
+{
+	std::stringstream parse (paramValue);
 
-	// Parse command line attribute
-	CommandLine cmd;
-	cmd.AddValue ("params", "File containing the parameters for the simulation", paramsFile);
-	cmd.AddValue ("reputationTraceFile", "File containing the reputation traces", overrideReputationTraceFile);
-//	cmd.AddValue ("traceFile", "Ns2 movement trace file", traceFile);
-//	cmd.AddValue ("outputFile", "Generated animation file", outputFile);
-//	cmd.AddValue ("reputationTraceFile", "Reputation values file", reputationTraceFile);
-//	cmd.AddValue ("nodeNum", "Number of nodes", numNodes);
-//	cmd.AddValue ("selfishNodes", "Number of nodes", selfishNodesP);
-//	cmd.AddValue ("altruisticNodes", "Number of nodes", altruisticNodesP);
-//	cmd.AddValue ("duration", "Duration of Simulation", duration);
-//	cmd.AddValue ("waitConfirmations", "Time window (in seconds) to wait for confirmations", waitForConfDelay);
-//	cmd.AddValue ("confirmationThr", "Number of confirmation needed for incident validation", confirmationThreshold);
-//	cmd.AddValue ("reputationThr", "Minimum reputation value needed for incident validation", reputationThreshold);
-//	cmd.AddValue ("generationInterval", "Incident generation interval (in seconds)", generationInterval);
-//	cmd.AddValue ("wifiRange", "Propagation loss range for the WifiChannel", wifiRange);
-//	cmd.AddValue ("t", "Enable or disable network topology dump", printNetworkTopology);
-//	cmd.AddValue ("topologyFile", "Network topology generated file", topologyFile);
-//	cmd.AddValue ("log", "Enable LOG_INFO messages", printLogInfo);
-	cmd.Parse (argc,argv);
+	if ( paramName == "traceFile" ) {
+		parse >> p.traceFile;
+	}
+	else if ( paramName == "mobilityCache" ) {
+		parse >> p.mobilityCacheFile;
+	}
+	else if ( paramName == "outputFile" ) {
+		parse >> p.outputFile;
+	}
+	else if ( paramName == "reputationTraceFile" ) {
+		parse >> p.reputationTraceFile;
+	}
+	else if ( paramName == "eventListFile" ) {
+		parse >> p.eventListFile;
+	}
+	else if ( paramName == "posStatsFile" ) {
+		parse >> p.posStatisticsFile;
+	}
+	else if ( paramName == "nodeNum" ) {
+		parse >> p.numNodes;
+	}
+	else if ( paramName == "selfishNodes" ) {
+		parse >> p.selfishNodesP;
+	}
+	else if ( paramName == "altruisticNodes" ) {
+		parse >> p.altruisticNodesP;
+	}
+	else if ( paramName == "maliciousNodes" ) {
+		parse >> p.maliciousNodesP;
+	}
+	else if ( paramName == "trustedNodes" ) {
+		parse >> p.trustedNodes;
+	}
+	else if ( paramName == "initialReputationValue" ) {
+		parse >> p.initialReputationValue;
+	}
+	else if ( paramName == "duration" ) {
+		parse >> p.duration;
+	}
+	else if ( paramName == "waitConfirmations" ) {
+		parse >> p.waitForConfDelay;
+	}
+	else if ( paramName == "validationMode" ) {
+		parse >> p.validationMode;
+	}
+	else if ( paramName == "weightFunction" ) {
+		parse >> p.weightFunction;
+	}
+	else if ( paramName == "weightTable" ) {
+		parse >> p.weightTable;
+	}
+	else if ( paramName == "confirmationThr" ) {
+		parse >> p.confirmationThreshold;
+	}
+	else if ( paramName == "falseIncidentThr" ) {
+		parse >> p.falseIncidentThreshold;
+	}
+	else if ( paramName == "reputationThr" ) {
+		parse >> p.reputationThreshold;
+	}
+	else if ( paramName == "generatedIncWeight" ) {
+		parse >> p.generatedIncWeight;
+	}
+	else if ( paramName == "generationInterval" ) {
+		parse >> p.generationInterval;
+	}
+	else if ( paramName == "wifiRange" ) {
+		parse >> p.wifiRange;
+	}
+	else if ( paramName == "t" ) {
+		parse >> p.printNetworkTopology;
+	}
+	else if ( paramName == "topologyFile" ) {
+		parse >> p.topologyFile;
+	}
+	else if ( paramName == "log" ) {
+		parse >> p.printLogInfo;
+	}
+	else if ( paramName == "seed" ) {
+		parse >> p.seed;
+	}
+	else if ( paramName == "run" ) {
+		parse >> p.run;
+	}
+	else if ( paramName == "anim" ) {
+		parse >> p.genAnimation;
+	}
+	else if ( paramName == "animStart" ) {
+		parse >> p.animStart;
+	}
+	else if ( paramName == "animStop" ) {
+		parse >> p.animStop;
+	}
+	else if ( paramName == "animIncident" ) {
+		parse >> p.animIncident;
+	}
+	else if ( paramName == "animMargin" ) {
+		parse >> p.animMargin;
+	}
+	else if ( paramName == "animPollInterval" ) {
+		parse >> p.animPollInterval;
+	}
+	else if ( paramName == "animPacketMetadata" ) {
+		parse >> p.animPacketMetadata;
+	}
+	else if ( paramName == "eventWindow" ) {
+		parse >> p.eventWindow;
+	}
+	else if ( paramName == "maxSpeed" ) {
+		parse >> p.maxSpeed;
+	}
+	else if ( paramName == "deliveryMode" ) {
+		parse >> p.deliveryMode;
+	}
+	else if ( paramName == "oracleDelay" ) {
+		parse >> p.oracleDelay;
+	}
+	else if ( paramName == "batchedUpdates" ) {
+		parse >> p.batchedUpdates;
+	}
+	else if ( paramName == "confirmationWindow" ) {
+		parse >> p.confirmationWindow;
+	}
+	else if ( paramName == "earlyDecision" ) {
+		parse >> p.earlyDecision;
+	}
+	else if ( paramName == "validator" ) {
+		parse >> p.validator;
+	}
+	else if ( paramName == "eventLog" ) {
+		parse >> p.eventLog;
+	}
+	else if ( paramName == "eventMask" ) {
+		parse >> p.eventMask;
+	}
+	else if ( paramName == "eventBuffer" ) {
+		parse >> p.eventBuffer;
+	}
+	else if ( paramName == "resourceLog" ) {
+		parse >> p.resourceLog;
+	}
+	else if ( paramName == "resourceInterval" ) {
+		parse >> p.resourceInterval;
+	}
+	else if ( paramName == "maxResidentSize" ) {
+		parse >> p.maxResidentSize;
+	}
+	else if ( paramName == "maxPendingIncidents" ) {
+		parse >> p.maxPendingIncidents;
+	}
+	else if ( paramName == "maxEventRate" ) {
+		parse >> p.maxEventRate;
+	}
+	else if ( paramName == "reputationTraceFormat" ) {
+		parse >> p.reputationTraceFormat;
+	}
+	else if ( paramName == "reputationTracePrecision" ) {
+		parse >> p.reputationTracePrecision;
+	}
+	else if ( paramName == "reputationTraceCompression" ) {
+		parse >> p.reputationTraceCompression;
+	}
+	else if ( paramName == "reputationKeyframeInterval" ) {
+		parse >> p.reputationKeyframeInterval;
+	}
+	else {
+		return false;
+	}
 
+	return true;
+}
+
+void
+ReadParamsFile (SimulationParams &p, std::string paramsFile)
+{
 	std::ifstream params (paramsFile.c_str ());
 	std::string paramTuple;
 	std::string::size_type pos;
@@ -320,96 +546,108 @@ int main (int argc, char *argv[])
 			pos = paramTuple.find ("=");
 			std::string paramName = paramTuple.substr(0, pos);
 			std::string paramValue = paramTuple.substr(pos + 1, paramTuple.size () - pos);
-			std::stringstream parse (paramValue);
-
-			if ( paramName == "traceFile" ) {
-				parse >> traceFile;
-			}
-			else if ( paramName == "outputFile" ) {
-				parse >> outputFile;
-			}
-			else if ( paramName == "reputationTraceFile" ) {
-				parse >> reputationTraceFile;
-			}
-			else if ( paramName == "eventListFile" ) {
-				parse >> eventListFile;
-			}
-			else if ( paramName == "posStatsFile" ) {
-				parse >> posStatisticsFile;
-			}
-			else if ( paramName == "nodeNum" ) {
-				parse >> numNodes;
-			}
-			else if ( paramName == "selfishNodes" ) {
-				parse >> selfishNodesP;
-			}
-			else if ( paramName == "altruisticNodes" ) {
-				parse >> altruisticNodesP;
-			}
-			else if ( paramName == "maliciousNodes" ) {
-				parse >> maliciousNodesP;
-			}
-			else if ( paramName == "trustedNodes" ) {
-				parse >> trustedNodes;
-			}
-			else if ( paramName == "initialReputationValue" ) {
-				parse >> initialReputationValue;
-			}
-			else if ( paramName == "duration" ) {
-				parse >> duration;
-			}
-			else if ( paramName == "waitConfirmations" ) {
-				parse >> waitForConfDelay;
-			}
-			else if ( paramName == "validationMode" ) {
-				parse >> validationMode;
-			}
-			else if ( paramName == "weightFunction" ) {
-				parse >> weightFunction;
-			}
-			else if ( paramName == "confirmationThr" ) {
-				parse >> confirmationThreshold;
-			}
-			else if ( paramName == "falseIncidentThr" ) {
-				parse >> falseIncidentThreshold;
-			}
-			else if ( paramName == "reputationThr" ) {
-				parse >> reputationThreshold;
-			}
-			else if ( paramName == "generatedIncWeight" ) {
-				parse >> generatedIncWeight;
-			}
-			else if ( paramName == "generationInterval" ) {
-				parse >> generationInterval;
-			}
-			else if ( paramName == "wifiRange" ) {
-				parse >> wifiRange;
-			}
-			else if ( paramName == "t" ) {
-				parse >> printNetworkTopology;
-			}
-			else if ( paramName == "topologyFile" ) {
-				parse >> topologyFile;
-			}
-			else if ( paramName == "log" ) {
-				parse >> printLogInfo;
-			}
-			else if ( paramName == "anim" ) {
-				parse >> genAnimation;
-			}
+			SetParam (p, paramName, paramValue);
 		}
 	}
 	params.close ();
+}
+
+/*
+ * Role of every node, in allNodes order (see RunSimulation).
+ */
+std::vector<uint8_t>
+GetNodeRoles (const SimulationParams &p)
+{
+	uint32_t numOfSelfishNodes = (uint32_t) p.numNodes * p.selfishNodesP;
+	uint32_t numOfAltruisticNodes = (uint32_t) p.numNodes * p.altruisticNodesP;
+	uint32_t numOfMaliciousNodes = (uint32_t) p.numNodes * p.maliciousNodesP;
+	uint32_t numOfRandomNodes = p.numNodes - numOfSelfishNodes - numOfAltruisticNodes - numOfMaliciousNodes;
+
+	std::vector<uint8_t> roles;
+	roles.insert (roles.end (), numOfSelfishNodes, (uint8_t) ReputationTraceWriter::SELFISH_NODE);
+	roles.insert (roles.end (), numOfAltruisticNodes, (uint8_t) ReputationTraceWriter::ALTRUISTIC_NODE);
+	roles.insert (roles.end (), numOfMaliciousNodes, (uint8_t) ReputationTraceWriter::MALICIOUS_NODE);
+	roles.insert (roles.end (), numOfRandomNodes, (uint8_t) ReputationTraceWriter::RANDOM_NODE);
+	return roles;
+}
+
+/*
+ * Animation window of 'p', in seconds. With animIncident the window is
+ * centred on that incident of the event list (counting from 0), which is
+ * read from the start and rewound. Returns false if there is no such
+ * incident.
+ */
+bool
+GetAnimationWindow (const SimulationParams &p, IncidentScheduleReader *schedule, double &start, double &stop)
+{
+	start = p.animStart;
+	stop = p.animStop > 0. ? p.animStop : p.duration;
+	if ( p.animIncident < 0 ) return true;
+
+	double time = 0.;
+	int32_t nodeId;
+	int32_t n = 0;
+	bool found = false;
+	schedule->Rewind ();
+	while ( !found && schedule->Next (time, nodeId) )
+	{
+		// Incidents of negative node ids are never generated
+		if ( nodeId >= 0 && n++ == p.animIncident ) found = true;
+	}
+	schedule->Rewind ();
+	if ( !found ) return false;
 
-	if ( !overrideReputationTraceFile.empty () ) reputationTraceFile = overrideReputationTraceFile;
+	start = std::max (0., time - p.animMargin);
+	stop = time + p.animMargin;
+	return true;
+}
 
-	if ( printLogInfo == 1 )
+int
+RunSimulation (const SimulationParams &p, IncidentScheduleReader *schedule,
+		const Ns2MobilityCache *mobility)
+{
+	// A batched confirmation leaves the sink up to the window plus 0.5s of
+	// jitter after the incident; any later and the generator has already
+	// decided it
+	if ( p.confirmationWindow > 0. && p.confirmationWindow + 0.5 >= p.waitForConfDelay )
+	{
+		std::cerr << "confirmationWindow (" << p.confirmationWindow << "s) plus 0.5s of jitter must stay below "
+				<< "waitConfirmations (" << p.waitForConfDelay << "s)" << std::endl;
+		return 1;
+	}
+
+	if ( p.printLogInfo == 1 )
 	{
 		LogComponentEnable ("IncidentGeneratorApplication", LOG_LEVEL_INFO);
 		LogComponentEnable ("IncidentSinkApplication", LOG_LEVEL_INFO);
 		LogComponentEnable ("IncidenciesMobilityTrace", LOG_LEVEL_INFO);
 	}
 
+	// The applications record their activity as events; 'log' prints them
+	// in the text format they used to log
+	IncidentEventLog::SetMask (0);
+	IncidentEventLog::SetEcho (0);
+	if ( p.printLogInfo == 1 || !p.eventLog.empty () )
+	{
+		IncidentEventLog::SetCapacity (p.eventBuffer);
+		IncidentEventLog::SetMask (p.eventMask);
+		if ( p.printLogInfo == 1 ) IncidentEventLog::SetEcho (&std::clog);
+		if ( !p.eventLog.empty () && !IncidentEventLog::Open (p.eventLog) )
+		{
+			std::cerr << "Unable to create event log " << p.eventLog << std::endl;
+			return 1;
+		}
+	}
+
+	// Every stochastic decision draws from ns-3 streams, so a (seed, run) pair
+	// fully determines the simulation
+	RngSeedManager::SetSeed (p.seed);
+	RngSeedManager::SetRun (p.run);
+
+	int64_t stream = 0;
+	scenarioRandom = CreateObject<UniformRandomVariable> ();
+	scenarioRandom->SetStream (stream++);
+
 //	traceFilePath.append (traceFile);
 
 	Config::SetDefault ("ns3::WifiRemoteStationManager::FragmentationThreshold", StringValue ("2200"));
@@ -417,27 +655,36 @@ int main (int argc, char *argv[])
 	Config::SetDefault ("ns3::WifiRemoteStationManager::NonUnicastMode",
 			StringValue ("DsssRate1Mbps"));
 
-	// Create Ns2MobilityHelper with the specified trace log file as parameter
-	Ns2MobilityHelper ns2 = Ns2MobilityHelper (traceFile);
+	// Use the compiled mobility trace if there is one, the ns-2 trace otherwise
+	Ns2MobilityCache ownMobilityCache (p.traceFile, p.mobilityCacheFile);
+	if ( mobility == 0 && !p.mobilityCacheFile.empty () )
+	{
+		if ( !ownMobilityCache.Load () )
+		{
+			std::cerr << "Unable to load mobility cache " << p.mobilityCacheFile << std::endl;
+			return 1;
+		}
+		mobility = &ownMobilityCache;
+	}
 
 	// Create all nodes.
 	NodeContainer selfishNodes, altruisticNodes, maliciousNodes, randomNodes;
-	uint32_t numOfSelfishNodes = (uint32_t) numNodes * selfishNodesP; // Nodes that are selfish by nature
+	uint32_t numOfSelfishNodes = (uint32_t) p.numNodes * p.selfishNodesP; // Nodes that are selfish by nature
 	selfishNodes.Create (numOfSelfishNodes);
-	InitializeNodeContainer(&selfishNodes, 1.0, .0, initialReputationValue);
+	InitializeNodeContainer(&selfishNodes, 1.0, .0, p.initialReputationValue);
 
-	uint32_t numOfAltruisticNodes = (uint32_t) numNodes * altruisticNodesP;
+	uint32_t numOfAltruisticNodes = (uint32_t) p.numNodes * p.altruisticNodesP;
 	altruisticNodes.Create (numOfAltruisticNodes);	// Nodes that are altruistic by nature
-	InitializeNodeContainer (&altruisticNodes, 0.0, .0, initialReputationValue);
-	SelectTrustedNodes (&altruisticNodes, trustedNodes);
+	InitializeNodeContainer (&altruisticNodes, 0.0, .0, p.initialReputationValue);
+	SelectTrustedNodes (&altruisticNodes, p.trustedNodes);
 
-	uint32_t numOfMaliciousNodes = (uint32_t) numNodes * maliciousNodesP;
+	uint32_t numOfMaliciousNodes = (uint32_t) p.numNodes * p.maliciousNodesP;
 	maliciousNodes.Create (numOfMaliciousNodes);
-	InitializeNodeContainer (&maliciousNodes, -1, .0, initialReputationValue);
+	InitializeNodeContainer (&maliciousNodes, -1, .0, p.initialReputationValue);
 
-	uint32_t numOfRandomNodes = numNodes - numOfSelfishNodes - numOfAltruisticNodes - numOfMaliciousNodes;
+	uint32_t numOfRandomNodes = p.numNodes - numOfSelfishNodes - numOfAltruisticNodes - numOfMaliciousNodes;
 	randomNodes.Create (numOfRandomNodes); // Node that have variable probability of being selfish
-	InitializeNodeContainer(&randomNodes, 0.5, .0, initialReputationValue);
+	InitializeNodeContainer(&randomNodes, 0.5, .0, p.initialReputationValue);
 
 	NodeContainer allNodes;
 	allNodes.Add (selfishNodes);
@@ -445,7 +692,16 @@ int main (int argc, char *argv[])
 	allNodes.Add (maliciousNodes);
 	allNodes.Add (randomNodes);
 
-	ns2.Install (); // configure movements for each node, while reading trace file
+	if ( mobility != 0 )
+	{
+		mobility->Install ();
+	}
+	else
+	{
+		// Create Ns2MobilityHelper with the specified trace log file as parameter
+		Ns2MobilityHelper ns2 = Ns2MobilityHelper (p.traceFile);
+		ns2.Install (); // configure movements for each node, while reading trace file
+	}
 
 	InternetStackHelper internet;
 	internet.Install (allNodes);
@@ -460,7 +716,7 @@ int main (int argc, char *argv[])
 	YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
 	wifiChannel.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel", "Speed", DoubleValue(1));
 	wifiChannel.AddPropagationLoss("ns3::RangePropagationLossModel", "MaxRange",
-			DoubleValue (wifiRange));
+			DoubleValue (p.wifiRange));
 
 	wifiPhy.SetChannel(wifiChannel.Create ());
 
@@ -477,34 +733,56 @@ int main (int argc, char *argv[])
 	// Create IncidentSink application and install it on all nodes
 	uint16_t port = 8089;
 	IncidentSinkHelper incidentSink (port);
-	incidentSink.SetAttribute ("ConfirmationWeight", DoubleValue (1/generatedIncWeight));
+	incidentSink.SetAttribute ("ConfirmationWeight", DoubleValue (1/p.generatedIncWeight));
+	incidentSink.SetAttribute ("ConfirmationWindow", TimeValue (Seconds (p.confirmationWindow)));
 	ApplicationContainer sinkApps = incidentSink.Install (allNodes);
 	sinkApps.Start (Seconds (1.0));
 
 	// Create IncidentGenerator application to generate new incidents and install it on all nodes
 	IncidentGeneratorHelper incidentGen (port);
 	incidentGen.SetAttribute ("StartOffset", TimeValue (Seconds (1.0)));
-	incidentGen.SetAttribute ("TimerDelay", TimeValue (Seconds (waitForConfDelay)));
-	incidentGen.SetAttribute ("ValidationMode", UintegerValue (validationMode));
-	incidentGen.SetAttribute ("WeightFunction", UintegerValue (weightFunction));
-	incidentGen.SetAttribute ("ConfirmationThreshold", DoubleValue (confirmationThreshold));
-	incidentGen.SetAttribute ("DecreaseThreshold", DoubleValue (falseIncidentThreshold));
-	incidentGen.SetAttribute ("ReputationThreshold", DoubleValue (reputationThreshold));
+	incidentGen.SetAttribute ("TimerDelay", TimeValue (Seconds (p.waitForConfDelay)));
+	incidentGen.SetAttribute ("ValidationMode", UintegerValue (p.validationMode));
+	incidentGen.SetAttribute ("WeightFunction", UintegerValue (p.weightFunction));
+	incidentGen.SetAttribute ("WeightTable", StringValue (p.weightTable));
+	incidentGen.SetAttribute ("ConfirmationThreshold", DoubleValue (p.confirmationThreshold));
+	incidentGen.SetAttribute ("DecreaseThreshold", DoubleValue (p.falseIncidentThreshold));
+	incidentGen.SetAttribute ("ReputationThreshold", DoubleValue (p.reputationThreshold));
 	incidentGen.SetAttribute ("GenerationWeight", DoubleValue (1.));
+	incidentGen.SetAttribute ("BatchedReputationUpdates", BooleanValue (p.batchedUpdates == 1));
+	incidentGen.SetAttribute ("EarlyDecision", BooleanValue (p.earlyDecision == 1));
+	if ( !p.validator.empty () )
+	{
+		// Validators keep no per-incident state, so all the generators share it
+		ObjectFactory validatorFactory;
+		validatorFactory.SetTypeId (p.validator);
+		validatorFactory.Set ("ConfirmationThreshold", DoubleValue (p.confirmationThreshold));
+		validatorFactory.Set ("DecreaseThreshold", DoubleValue (p.falseIncidentThreshold));
+		struct TypeId::AttributeInformation info;
+		if ( validatorFactory.GetTypeId ().LookupAttributeByName ("WeightFunction", &info) )
+		{
+			validatorFactory.Set ("WeightFunction", UintegerValue (p.weightFunction));
+			validatorFactory.Set ("ReputationThreshold", DoubleValue (p.reputationThreshold));
+			validatorFactory.Set ("TableFile", StringValue (p.weightTable));
+		}
+		incidentGen.SetAttribute ("Validator", PointerValue (validatorFactory.Create<IncidentValidator> ()));
+	}
 	ApplicationContainer generatorApps = incidentGen.Install (allNodes);
 	generatorApps.Start (Seconds (1.0));
 
-	Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+	stream += incidentSink.AssignStreams (allNodes, stream);
+	stream += incidentGen.AssignStreams (allNodes, stream);
 
-	// Initialize current reputation array with the initial values for all the nodes
-	for (unsigned int i = 0; i < allNodes.GetN (); i++)
-	{
-		DoubleValue rep; allNodes.Get (i)->GetAttribute("Reputation", rep);
-		currentReputationValues.push_back(rep.Get ());
-	}
+	// Dispatches the incidents to the IncidentGenerator applications
+	Ptr<IncidentScheduler> incidents = CreateObject<IncidentScheduler> ();
+	incidents->SetNodes (allNodes);
+	stream += incidents->AssignStreams (stream);
+
+	Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
-	// Define traceback call for changes in the reputation value
-	Config::Connect ("/NodeList/*/Reputation", MakeCallback (&ReputationValueTrace));
+	// Follow the reputation of all the nodes, starting from their initial values
+	Ptr<ReputationMonitor> reputation = CreateObject<ReputationMonitor> ();
+	reputation->Install (allNodes);
 
 	// Define traceback call for changes in the position and/or velocity vector
 	//Config::Connect ("/NodeList/*/$ns3::MobilityModel/CourseChange", MakeCallback (&CourseChange));
@@ -514,89 +792,618 @@ int main (int argc, char *argv[])
 	//Config::Connect ("NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/PhyRxBegin",
 	//		MakeCallback (&WifiPhyRxBeginTrace));
 
-	if ( printNetworkTopology == 1 ) // Print network topology if indicated
-		DumpNodeInfo (allNodes, topologyFile);
+	if ( p.printNetworkTopology == 1 ) // Print network topology if indicated
+		DumpNodeInfo (allNodes, p.topologyFile);
 
-	std::ofstream repFile (reputationTraceFile.c_str ());
+	// Role of every node, in allNodes order, for the reputation trace header
+	std::vector<uint8_t> roles = GetNodeRoles (p);
+
+	Ptr<ReputationTraceWriter> repTrace = CreateReputationTraceWriter (p.reputationTraceFormat,
+			p.reputationTracePrecision, p.reputationTraceCompression, p.reputationKeyframeInterval);
+	if ( !repTrace->Open (p.reputationTraceFile, roles) )
+	{
+		std::cerr << "Unable to create reputation trace " << p.reputationTraceFile << std::endl;
+		return 1;
+	}
+	reputation->SetTraceWriter (repTrace);
 
 	// Print reputation values information
-	Simulator::Schedule (Seconds (1.0), &DumpReputationValues, &repFile, generationInterval);
+	Simulator::Schedule (Seconds (1.0), &DumpReputationValues, repTrace, reputation, incidents, p.generationInterval);
 
 	// Start generating incidents
-	//Simulator::Schedule (Seconds (3.0), &NewEvent, allNodes, generationInterval);
-	// Schedule incident generation events based on the event list passed along as a parameter
-	std::ifstream eventList (eventListFile.c_str ());
-	std::ofstream posStatistics (posStatisticsFile.c_str ());
-	std::string event;
-	while ( !eventList.eof() ) {
+	//incidents->StartRandomIncidents (Seconds (3.0), Seconds (p.generationInterval));
+	// Schedule incident generation events based on the event list passed along as a parameter.
+	// Only the next 'eventWindow' incidents are in the event queue at any time
+	std::ofstream posStatistics (p.posStatisticsFile.c_str ());
+	posStatistics << "#nodeId,x,y,inRange,selfish,altruistic,malicious,random,neighbours (id,x,y)...\n";
+
+	// Neighbourhood queries go through a grid of wifiRange cells, which
+	// follows the speed of the nodes unless maxSpeed is given
+	Ptr<SpatialGridIndex> grid = CreateObject<SpatialGridIndex> ();
+	grid->SetAttribute ("CellSize", DoubleValue (p.wifiRange));
+	grid->SetAttribute ("MaxSpeed", DoubleValue (p.maxSpeed));
+	grid->Install (allNodes);
+
+	// The oracle delivers the messages of the applications straight from the
+	// node positions; the wifi devices stay installed but carry no traffic
+	Ptr<IncidentOracle> oracle;
+	if ( p.deliveryMode == "oracle" )
+	{
+		oracle = CreateObject<IncidentOracle> ();
+		oracle->SetAttribute ("Range", DoubleValue (p.wifiRange));
+		oracle->SetAttribute ("BroadcastDelay", TimeValue (Seconds (p.oracleDelay)));
+		oracle->SetAttribute ("UnicastDelay", TimeValue (Seconds (p.oracleDelay)));
+		oracle->Install (allNodes, grid);
+	}
+	else if ( p.deliveryMode != "stack" )
+	{
+		std::cerr << "Unknown delivery mode '" << p.deliveryMode << "'" << std::endl;
+		return 1;
+	}
+
+	PosStatisticsContext posContext;
+	posContext.grid = grid;
+	posContext.roles = &roles;
+	posContext.range = p.wifiRange;
+	posContext.os = &posStatistics;
+	incidents->TraceConnectWithoutContext ("Incident", MakeBoundCallback (&DumpPosStatistics, &posContext));
+
+	// Resource samples and limits, only when asked for
+	Ptr<ResourceMonitor> resources;
+	if ( !p.resourceLog.empty () || p.maxResidentSize != 0 || p.maxPendingIncidents != 0 || p.maxEventRate != 0. )
+	{
+		resources = CreateObject<ResourceMonitor> ();
+		resources->SetAttribute ("Interval", TimeValue (Seconds (p.resourceInterval)));
+		resources->SetAttribute ("MaxResidentSize", UintegerValue (p.maxResidentSize));
+		resources->SetAttribute ("MaxPendingIncidents", UintegerValue (p.maxPendingIncidents));
+		resources->SetAttribute ("MaxEventRate", DoubleValue (p.maxEventRate));
+		if ( !resources->Open (p.resourceLog) )
+		{
+			std::cerr << "Unable to create resource log " << p.resourceLog << std::endl;
+			return 1;
+		}
+	}
 
-		std::getline(eventList, event);
-		// We only process the lines that begin with '$ns_ at'
-		if ( !(event.find("$ns_ at") == std::string::npos) ) {
+	// Animation is opt-in: without anim=1 there is no AnimationInterface, so
+	// no trace is connected and no file is opened. The packet metadata is
+	// most of the XML and stays out unless asked for. NetAnim in this ns-3
+	// animates all the nodes; a long run is cut down to a time window instead
+	AnimationInterface *animation = 0;
+	if ( p.genAnimation == 1 )
+	{
+		double animStart, animStop;
+		if ( !GetAnimationWindow (p, schedule, animStart, animStop) )
+		{
+			std::cerr << "No incident " << p.animIncident << " in the event list" << std::endl;
+			return 1;
+		}
 
-			NS_LOG_INFO ("==PROCESSED EVENT: " << event << "==");
+		NS_LOG_INFO ("Generating animation file from " << animStart << "s to " << animStop << "s...");
+		animation = new AnimationInterface (p.outputFile.c_str ());
+		animation->EnablePacketMetadata (p.animPacketMetadata == 1);
+		animation->SetMobilityPollInterval (Seconds (p.animPollInterval));
+		animation->SetStartTime (Seconds (animStart));
+		animation->SetStopTime (Seconds (animStop));
+	}
 
-			std::stringstream eventStream (event);
-			std::string info;
-			std::vector<std::string> eventInfo;
+	schedule->Rewind ();
+	schedule->Start (MakeCallback (&IncidentScheduler::GenerateIncident, incidents), p.eventWindow);
 
-			while ( std::getline(eventStream, info, ' ') ) {
-				eventInfo.push_back(info);
-			}
+	NS_LOG_INFO("Starting simulation...");
+
+	Simulator::Stop (Seconds (p.duration));
+	Simulator::Run ();
+
+	if ( oracle != 0 )
+	{
+		NS_LOG_INFO ("Oracle messages lost out of range: " << oracle->GetLostMessages ());
+	}
 
-			//NS_LOG_INFO ("Event string separated into " << eventInfo.size() << " parts");
-			NS_LOG_INFO ("Time and node info: " << eventInfo.at (EVENT_TIME_INFO) << " " << eventInfo.at (EVENT_NODE_INFO));
+	bool limitExceeded = false;
+	if ( resources != 0 )
+	{
+		limitExceeded = resources->GetLimitExceeded ();
+		resources->Close ();
+	}
 
-			// Decode the time when an incident should be generated
-			std::stringstream toDouble (eventInfo.at (EVENT_TIME_INFO));
-			double timeAt = .0; toDouble >> timeAt;
+	Simulator::Destroy ();
 
-			// Decode the Node that should generate the incident
-			std::string nodeIdStr = eventInfo.at (EVENT_NODE_INFO).substr(
-					NODE_INFO_LENGTH,
-					eventInfo.at (EVENT_NODE_INFO).length() - NODE_INFO_LENGTH - 1);
+	// Writes the end of the XML
+	delete animation;
 
-			//NS_LOG_INFO ("Parsed nodeId: " << nodeIdStr);
+	repTrace->Close ();
+	posStatistics.close ();
 
-			std::stringstream toInteger (nodeIdStr);
-			int32_t nodeId = 0; toInteger >> nodeId;
+	return limitExceeded ? 2 : 0;
+}
 
-			NS_LOG_INFO ("Parsed nodeId=" << nodeId);
+/*
+ * Reads back the frames of the reputation trace of 'p', whatever its
+ * format. Returns false if the trace cannot be read.
+ */
+bool
+ReadReputationTrace (const SimulationParams &p, std::vector<uint32_t> &generated,
+		std::vector<std::vector<double> > &frames)
+{
+	generated.clear ();
+	frames.clear ();
 
-			if ( nodeId >= 0 ) {
-				Simulator::Schedule (Seconds (timeAt), &AddEvent, allNodes, nodeId);
-				Simulator::Schedule (Seconds (timeAt), &DumpPosStatistics, &posStatistics, allNodes, nodeId);
-			}
+	if ( p.reputationTraceFormat != "csv" )
+	{
+		ReputationTraceReader trace;
+		if ( !trace.Open (p.reputationTraceFile) ) return false;
 
+		double time;
+		uint32_t generatedIncidents;
+		std::vector<double> reputation;
+		while ( trace.ReadFrame (time, generatedIncidents, reputation) )
+		{
+			generated.push_back (generatedIncidents);
+			frames.push_back (reputation);
 		}
+		return true;
 	}
 
-	NS_LOG_INFO("Starting simulation...");
+	std::ifstream trace (p.reputationTraceFile.c_str ());
+	if ( !trace.is_open () ) return false;
 
-	Simulator::Stop (Seconds (duration));
+	std::string row;
+	while ( std::getline (trace, row) )
+	{
+		std::stringstream ss (row);
+		std::string item;
+		if ( !std::getline (ss, item, ',') ) continue;
+		generated.push_back (atoi (item.c_str ()));
+		frames.push_back (std::vector<double> ());
+		while ( std::getline (ss, item, ',') ) frames.back ().push_back (atof (item.c_str ()));
+	}
+	return true;
+}
+
+/*
+ * Runs 'p' in a worker process and returns its exit status, and its wall
+ * clock duration in 'seconds'.
+ */
+int
+RunTimedSimulation (const SimulationParams &p, IncidentScheduleReader *schedule,
+		const Ns2MobilityCache *mobility, double &seconds)
+{
+	struct timeval start, end;
+	gettimeofday (&start, 0);
+
+	pid_t pid = fork ();
+	if ( pid == 0 )
+	{
+		_exit (RunSimulation (p, schedule, mobility));
+	}
+	else if ( pid < 0 )
+	{
+		std::cerr << "Unable to fork simulation: " << strerror (errno) << std::endl;
+		return 1;
+	}
 
+	int status;
+	waitpid (pid, &status, 0);
+	gettimeofday (&end, 0);
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
 
-	NS_LOG_INFO ("Generating animation file...");
+	return WIFEXITED (status) ? WEXITSTATUS (status) : 1;
+}
 
-	// Generate NetAnim XML file
-	AnimationInterface animation (outputFile.c_str ());
-	animation.EnablePacketMetadata (true);
-	animation.SetStartTime(Seconds (.0));
+/*
+ * Validation harness of the oracle delivery mode: runs the same scenario
+ * through the wifi stack and through the oracle and reports how far their
+ * reputation traces are from each other. Collisions and MAC losses only
+ * exist in the stack, so the traces are close but not identical.
+ */
+int
+CompareDeliveryModes (const SimulationParams &base, IncidentScheduleReader *schedule,
+		const Ns2MobilityCache *mobility)
+{
+	const char *modes[2] = { "stack", "oracle" };
+	SimulationParams runs[2] = { base, base };
+	double seconds[2] = { 0., 0. };
+	std::vector<uint32_t> generated[2];
+	std::vector<std::vector<double> > frames[2];
 
-	if ( genAnimation == 1 ) {
-		animation.SetStopTime(Seconds (duration));
+	for ( unsigned int m = 0; m < 2; m++ )
+	{
+		runs[m].deliveryMode = modes[m];
+		runs[m].reputationTraceFile = base.reputationTraceFile + "." + modes[m];
+		runs[m].posStatisticsFile = base.posStatisticsFile.empty () ? "" : base.posStatisticsFile + "." + modes[m];
+		runs[m].outputFile = base.outputFile.empty () ? "" : base.outputFile + "." + modes[m];
+		runs[m].topologyFile = base.topologyFile.empty () ? "" : base.topologyFile + "." + modes[m];
+		runs[m].eventLog = base.eventLog.empty () ? "" : base.eventLog + "." + modes[m];
+		runs[m].resourceLog = base.resourceLog.empty () ? "" : base.resourceLog + "." + modes[m];
+
+		if ( RunTimedSimulation (runs[m], schedule, mobility, seconds[m]) != 0
+				|| !ReadReputationTrace (runs[m], generated[m], frames[m]) )
+		{
+			std::cerr << "The " << modes[m] << " simulation failed" << std::endl;
+			return 1;
+		}
 	}
-	else {
-		animation.SetStopTime(Seconds (.0));
+
+	std::vector<uint8_t> roles = GetNodeRoles (base);
+	uint32_t nFrames = std::min (frames[0].size (), frames[1].size ());
+
+	double sumDiff = 0.;
+	double maxDiff = 0.;
+	uint32_t nValues = 0;
+	uint32_t generatedMismatches = 0;
+	for ( uint32_t f = 0; f < nFrames; f++ )
+	{
+		if ( generated[0][f] != generated[1][f] ) ++generatedMismatches;
+		uint32_t n = std::min (frames[0][f].size (), frames[1][f].size ());
+		for ( uint32_t i = 0; i < n; i++ )
+		{
+			double diff = fabs (frames[0][f][i] - frames[1][f][i]);
+			sumDiff += diff;
+			maxDiff = std::max (maxDiff, diff);
+			++nValues;
+		}
 	}
 
-	Simulator::Run ();
-	Simulator::Destroy ();
+	// Mean final reputation of every role
+	double roleSum[2][4] = { { 0., 0., 0., 0. }, { 0., 0., 0., 0. } };
+	uint32_t roleCount[4] = { 0, 0, 0, 0 };
+	if ( nFrames > 0 )
+	{
+		for ( uint32_t i = 0; i < roles.size (); i++ )
+		{
+			if ( i >= frames[0][nFrames - 1].size () || i >= frames[1][nFrames - 1].size () ) break;
+			roleCount[roles[i] & 3]++;
+			for ( unsigned int m = 0; m < 2; m++ ) roleSum[m][roles[i] & 3] += frames[m][nFrames - 1][i];
+		}
+	}
 
-	//repFile.close ();
-	posStatistics.close ();
+	const char *roleNames[4] = { "selfish", "altruistic", "malicious", "random" };
+	std::cout << "mode,wallClock,frames\n";
+	for ( unsigned int m = 0; m < 2; m++ )
+	{
+		std::cout << modes[m] << "," << seconds[m] << "," << frames[m].size () << "\n";
+	}
+	std::cout << "speedup," << (seconds[1] > 0 ? seconds[0] / seconds[1] : 0.) << "\n";
+	std::cout << "framesCompared," << nFrames << "\n";
+	std::cout << "generatedMismatches," << generatedMismatches << "\n";
+	std::cout << "meanAbsDiff," << (nValues > 0 ? sumDiff / nValues : 0.) << "\n";
+	std::cout << "maxAbsDiff," << maxDiff << "\n";
+	std::cout << "role,nodes,stackFinal,oracleFinal\n";
+	for ( unsigned int r = 0; r < 4; r++ )
+	{
+		if ( roleCount[r] == 0 ) continue;
+		std::cout << roleNames[r] << "," << roleCount[r] << "," << roleSum[0][r] / roleCount[r]
+				<< "," << roleSum[1][r] / roleCount[r] << "\n";
+	}
 
 	return 0;
 }
 
+/*
+ * One point of a parameter sweep: the (key, value) pairs that override the
+ * base params file.
+ */
+typedef std::vector<std::pair<std::string, std::string> > SweepPoint;
+
+/*
+ * Expands a sweep value list. Values are separated by ',' and an integer
+ * range can be given as 'first..last' (e.g. 'run=1..32').
+ */
+std::vector<std::string>
+ExpandSweepValues (std::string values)
+{
+	std::vector<std::string> expanded;
+	std::stringstream ss (values);
+	std::string item;
+
+	while ( std::getline (ss, item, ',') )
+	{
+		std::string::size_type range = item.find ("..");
+		if ( range != std::string::npos )
+		{
+			std::stringstream firstStr (item.substr (0, range));
+			std::stringstream lastStr (item.substr (range + 2));
+			int64_t first = 0; firstStr >> first;
+			int64_t last = 0; lastStr >> last;
+			for ( int64_t v = first; v <= last; v++ )
+			{
+				std::stringstream value; value << v;
+				expanded.push_back (value.str ());
+			}
+		}
+		else if ( !item.empty () )
+		{
+			expanded.push_back (item);
+		}
+	}
+
+	return expanded;
+}
+
+/*
+ * Reads a sweep specification. It uses the params file keys:
+ *
+ *   confirmationThr=1,2,3		grid axis, crossed with all other axes
+ *   run=1..32					integer range
+ *   @validationMode=2 weightFunction=22	explicit point (list mode)
+ *
+ * The explicit points (or a single empty point if there are none) are
+ * crossed with every grid axis.
+ */
+std::vector<SweepPoint>
+ReadSweepSpec (std::string sweepFile, std::vector<std::string> *sweptKeys)
+{
+	std::vector<SweepPoint> points;
+	std::vector<std::pair<std::string, std::vector<std::string> > > axes;
+
+	std::ifstream spec (sweepFile.c_str ());
+	std::string line;
+	while ( std::getline (spec, line) )
+	{
+		if ( line.empty () || line[0] == '#' ) continue;
+
+		if ( line[0] == '@' )
+		{
+			SweepPoint point;
+			std::stringstream ss (line.substr (1));
+			std::string tuple;
+			while ( ss >> tuple )
+			{
+				std::string::size_type pos = tuple.find ("=");
+				if ( pos == std::string::npos ) continue;
+				std::string key = tuple.substr (0, pos);
+				point.push_back (std::make_pair (key, tuple.substr (pos + 1)));
+				if ( std::find (sweptKeys->begin (), sweptKeys->end (), key) == sweptKeys->end () )
+					sweptKeys->push_back (key);
+			}
+			points.push_back (point);
+		}
+		else
+		{
+			std::string::size_type pos = line.find ("=");
+			if ( pos == std::string::npos ) continue;
+			std::string key = line.substr (0, pos);
+			axes.push_back (std::make_pair (key, ExpandSweepValues (line.substr (pos + 1))));
+			if ( std::find (sweptKeys->begin (), sweptKeys->end (), key) == sweptKeys->end () )
+				sweptKeys->push_back (key);
+		}
+	}
+
+	if ( points.empty () ) points.push_back (SweepPoint ());
+
+	for ( unsigned int a = 0; a < axes.size (); a++ )
+	{
+		std::vector<SweepPoint> crossed;
+		for ( unsigned int i = 0; i < points.size (); i++ )
+		{
+			for ( unsigned int v = 0; v < axes[a].second.size (); v++ )
+			{
+				SweepPoint point = points[i];
+				point.push_back (std::make_pair (axes[a].first, axes[a].second[v]));
+				crossed.push_back (point);
+			}
+		}
+		points = crossed;
+	}
+
+	return points;
+}
+
+std::string
+PerRunFileName (std::string base, uint32_t index)
+{
+	if ( base.empty () ) return base;
+	std::stringstream name;
+	name << base << "." << index;
+	return name.str ();
+}
+
+/*
+ * Runs every sweep point in its own worker process, at most 'jobs' at a
+ * time. The workers are forked after the event list and the mobility cache
+ * have been mapped, so they all share them. The per-run reputation
+ * traces are then merged into 'sweepOutput', each row prefixed by the point
+ * index and its parameters.
+ */
+int
+RunSweep (const SimulationParams &base, IncidentScheduleReader *schedule,
+		const Ns2MobilityCache *mobility, std::string sweepFile, uint32_t jobs, std::string sweepOutput)
+{
+	std::vector<std::string> sweptKeys;
+	std::vector<SweepPoint> points = ReadSweepSpec (sweepFile, &sweptKeys);
+	std::vector<SimulationParams> runs (points.size (), base);
+
+	for ( unsigned int i = 0; i < points.size (); i++ )
+	{
+		for ( unsigned int k = 0; k < points[i].size (); k++ )
+		{
+			if ( !SetParam (runs[i], points[i][k].first, points[i][k].second) )
+			{
+				std::cerr << "Unknown sweep parameter '" << points[i][k].first << "'" << std::endl;
+				return 1;
+			}
+		}
+		runs[i].reputationTraceFile = PerRunFileName (sweepOutput, i);
+		runs[i].posStatisticsFile = PerRunFileName (runs[i].posStatisticsFile, i);
+		runs[i].outputFile = PerRunFileName (runs[i].outputFile, i);
+		runs[i].topologyFile = PerRunFileName (runs[i].topologyFile, i);
+		runs[i].eventLog = PerRunFileName (runs[i].eventLog, i);
+		runs[i].resourceLog = PerRunFileName (runs[i].resourceLog, i);
+	}
+
+	NS_LOG_INFO ("Running " << runs.size () << " sweep points on " << jobs << " workers...");
+
+	uint32_t next = 0;
+	uint32_t running = 0;
+	uint32_t failed = 0;
+	while ( next < runs.size () || running > 0 )
+	{
+		while ( next < runs.size () && running < jobs )
+		{
+			pid_t pid = fork ();
+			if ( pid == 0 )
+			{
+				// Points that change the mobility trace load their own cache
+				bool sameMobility = runs[next].traceFile == base.traceFile
+						&& runs[next].mobilityCacheFile == base.mobilityCacheFile;
+				// Points that change the event list map their own
+				IncidentScheduleReader ownSchedule;
+				IncidentScheduleReader *runSchedule = schedule;
+				if ( runs[next].eventListFile != base.eventListFile )
+				{
+					if ( !ownSchedule.Open (runs[next].eventListFile) ) _exit (1);
+					runSchedule = &ownSchedule;
+				}
+				_exit (RunSimulation (runs[next], runSchedule, sameMobility ? mobility : 0));
+			}
+			else if ( pid < 0 )
+			{
+				std::cerr << "Unable to fork sweep worker: " << strerror (errno) << std::endl;
+				return 1;
+			}
+			++next;
+			++running;
+		}
+
+		int status;
+		if ( wait (&status) > 0 )
+		{
+			--running;
+			if ( !WIFEXITED (status) || WEXITSTATUS (status) != 0 ) ++failed;
+		}
+	}
+
+	// Merge the per-run traces into one indexed file
+	std::ofstream merged (sweepOutput.c_str ());
+	merged << "#point";
+	for ( unsigned int k = 0; k < sweptKeys.size (); k++ ) merged << "," << sweptKeys[k];
+	merged << ",generatedEvents,reputation...\n";
+
+	for ( unsigned int i = 0; i < runs.size (); i++ )
+	{
+		std::stringstream prefix;
+		prefix << i;
+		for ( unsigned int k = 0; k < sweptKeys.size (); k++ )
+		{
+			std::string value;
+			for ( unsigned int j = 0; j < points[i].size (); j++ )
+				if ( points[i][j].first == sweptKeys[k] ) value = points[i][j].second;
+			prefix << "," << value;
+		}
+
+		if ( runs[i].reputationTraceFormat != "csv" )
+		{
+			ReputationTraceReader runTrace;
+			double time;
+			uint32_t generated;
+			std::vector<double> reputation;
+			if ( runTrace.Open (runs[i].reputationTraceFile) )
+			{
+				while ( runTrace.ReadFrame (time, generated, reputation) )
+				{
+					merged << prefix.str () << "," << generated;
+					for ( unsigned int n = 0; n < reputation.size (); n++ ) merged << "," << reputation[n];
+					merged << "\n";
+				}
+			}
+		}
+		else
+		{
+			std::ifstream runTrace (runs[i].reputationTraceFile.c_str ());
+			std::string row;
+			while ( std::getline (runTrace, row) )
+			{
+				merged << prefix.str () << "," << row << "\n";
+			}
+			runTrace.close ();
+		}
+		remove (runs[i].reputationTraceFile.c_str ());
+	}
+	merged.close ();
+
+	NS_LOG_INFO ("Sweep finished: " << runs.size () << " points, " << failed << " failed.");
+
+	return failed == 0 ? 0 : 1;
+}
+
+int main (int argc, char *argv[])
+{
+	// Enable logging from the ns2 helper
+	//LogComponentEnable ("Ns2MobilityHelper",LOG_LEVEL_DEBUG);
+	LogComponentEnable ("IncidenciesMobilityTrace", LOG_LEVEL_INFO);
+
+	std::string 	paramsFile;
+//	std::string		traceFilePath = "/home/cristian/apps/bonnmotion-2.0/mobility-traces";
+	std::string		overrideReputationTraceFile;
+	uint64_t		overrideRun = 0;
+	std::string		sweepFile;
+	std::string		sweepOutput = "sweep-results.csv";
+	uint32_t		jobs = sysconf (_SC_NPROCESSORS_ONLN);
+	uint32_t		compare = 0;
+
+	// Parse command line attribute
+	CommandLine cmd;
+	cmd.AddValue ("params", "File containing the parameters for the simulation", paramsFile);
+	cmd.AddValue ("reputationTraceFile", "File containing the reputation traces", overrideReputationTraceFile);
+	cmd.AddValue ("run", "Run number of the random number generator (overrides the params file)", overrideRun);
+	cmd.AddValue ("sweep", "Sweep specification; runs every point of it instead of a single simulation", sweepFile);
+	cmd.AddValue ("jobs", "Number of concurrent sweep workers", jobs);
+	cmd.AddValue ("sweepOutput", "Merged reputation traces of all the sweep points", sweepOutput);
+	cmd.AddValue ("compare", "Run the simulation with both delivery modes and compare their reputation traces", compare);
+//	cmd.AddValue ("traceFile", "Ns2 movement trace file", traceFile);
+//	cmd.AddValue ("outputFile", "Generated animation file", outputFile);
+//	cmd.AddValue ("reputationTraceFile", "Reputation values file", reputationTraceFile);
+//	cmd.AddValue ("nodeNum", "Number of nodes", numNodes);
+//	cmd.AddValue ("selfishNodes", "Number of nodes", selfishNodesP);
+//	cmd.AddValue ("altruisticNodes", "Number of nodes", altruisticNodesP);
+//	cmd.AddValue ("duration", "Duration of Simulation", duration);
+//	cmd.AddValue ("waitConfirmations", "Time window (in seconds) to wait for confirmations", waitForConfDelay);
+//	cmd.AddValue ("confirmationThr", "Number of confirmation needed for incident validation", confirmationThreshold);
+//	cmd.AddValue ("reputationThr", "Minimum reputation value needed for incident validation", reputationThreshold);
+//	cmd.AddValue ("generationInterval", "Incident generation interval (in seconds)", generationInterval);
+//	cmd.AddValue ("wifiRange", "Propagation loss range for the WifiChannel", wifiRange);
+//	cmd.AddValue ("t", "Enable or disable network topology dump", printNetworkTopology);
+//	cmd.AddValue ("topologyFile", "Network topology generated file", topologyFile);
+//	cmd.AddValue ("log", "Enable LOG_INFO messages", printLogInfo);
+	cmd.Parse (argc,argv);
+
+	SimulationParams params;
+	ReadParamsFile (params, paramsFile);
+
+	if ( !overrideReputationTraceFile.empty () ) params.reputationTraceFile = overrideReputationTraceFile;
+	if ( overrideRun != 0 ) params.run = overrideRun;
+
+	// The event list and the mobility cache are loaded once, before any
+	// sweep worker is forked
+	IncidentScheduleReader schedule;
+	if ( !schedule.Open (params.eventListFile) )
+	{
+		std::cerr << "Unable to open event list " << params.eventListFile << std::endl;
+		return 1;
+	}
+
+	Ns2MobilityCache mobilityCache (params.traceFile, params.mobilityCacheFile);
+	const Ns2MobilityCache *mobility = 0;
+	if ( !params.mobilityCacheFile.empty () )
+	{
+		if ( !mobilityCache.Load () )
+		{
+			std::cerr << "Unable to load mobility cache " << params.mobilityCacheFile << std::endl;
+			return 1;
+		}
+		mobility = &mobilityCache;
+	}
 
+	if ( !sweepFile.empty () )
+	{
+		if ( jobs == 0 ) jobs = 1;
+		return RunSweep (params, &schedule, mobility, sweepFile, jobs, sweepOutput);
+	}
+
+	if ( compare == 1 )
+	{
+		return CompareDeliveryModes (params, &schedule, mobility);
+	}
+
+	return RunSimulation (params, &schedule, mobility);
+}
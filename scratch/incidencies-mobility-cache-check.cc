@@ -0,0 +1,159 @@
+/*
+ * incidencies-mobility-cache-check.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+/*
+ * Checks that Ns2MobilityCache moves the nodes like Ns2MobilityHelper. The
+ * trace is installed once through the cache, on the first nodes of the
+ * NodeList, and once through the helper, on as many nodes after them; the
+ * positions of both copies are then compared every 'step' seconds.
+ *
+ * Without 'trace', a built-in trace with timed 'set' commands (a teleport
+ * at rest, simultaneous X_ and Y_, a set followed by a setdest at the same
+ * time, a set at time 0) is checked. Returns 1 if any position is more
+ * than 'tolerance' meters off.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/ns2-mobility-helper.h"
+#include "ns3/applications-module.h"
+
+#include <fstream>
+#include <iostream>
+
+using namespace ns3;
+
+static const char *SAMPLE_TRACE =
+		"$node_(0) set X_ 10.0\n"
+		"$node_(0) set Y_ 20.0\n"
+		"$node_(0) set Z_ 0.0\n"
+		"$node_(1) set X_ 0.0\n"
+		"$node_(1) set Y_ 0.0\n"
+		"$node_(1) set Z_ 0.0\n"
+		"$ns_ at 0.0 \"$node_(1) set X_ 5.0\"\n"
+		"$ns_ at 1.0 \"$node_(0) setdest 50.0 20.0 10.0\"\n"
+		"$ns_ at 6.0 \"$node_(0) set X_ 100.0\"\n"
+		"$ns_ at 6.0 \"$node_(0) set Y_ 100.0\"\n"
+		"$ns_ at 6.0 \"$node_(0) setdest 100.0 150.0 5.0\"\n"
+		"$ns_ at 3.0 \"$node_(1) setdest 30.0 0.0 5.0\"\n"
+		"$ns_ at 10.0 \"$node_(1) set Y_ 40.0\"\n"
+		"$ns_ at 12.5 \"$node_(1) setdest 30.0 80.0 8.0\"\n"
+		"$ns_ at 20.0 \"$node_(0) set X_ 0.0\"\n";
+
+struct CheckContext
+{
+	NodeContainer	cached;
+	NodeContainer	reference;
+	double			maxError;
+	double			maxErrorTime;
+	uint32_t		maxErrorNode;
+};
+
+static void
+Compare (CheckContext *context)
+{
+	for ( uint32_t i = 0; i < context->cached.GetN (); i++ )
+	{
+		Ptr<MobilityModel> cached = context->cached.Get (i)->GetObject<MobilityModel> ();
+		Ptr<MobilityModel> reference = context->reference.Get (i)->GetObject<MobilityModel> ();
+		if ( cached == 0 || reference == 0 ) continue;
+
+		double error = CalculateDistance (cached->GetPosition (), reference->GetPosition ());
+		if ( error > context->maxError )
+		{
+			context->maxError = error;
+			context->maxErrorTime = Simulator::Now ().GetSeconds ();
+			context->maxErrorNode = i;
+		}
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	std::string		traceFile;
+	std::string		cacheFile = "incidencies-mobility-cache-check.cache";
+	double			duration = 40.;
+	double			step = .1;
+	double			tolerance = 1e-6;
+
+	CommandLine cmd;
+	cmd.AddValue ("trace", "ns-2 mobility trace (the built-in one if empty)", traceFile);
+	cmd.AddValue ("cache", "Compiled trace to write", cacheFile);
+	cmd.AddValue ("duration", "Seconds to compare", duration);
+	cmd.AddValue ("step", "Seconds between two comparisons", step);
+	cmd.AddValue ("tolerance", "Largest distance, in meters, allowed between the positions", tolerance);
+	cmd.Parse (argc, argv);
+
+	if ( traceFile.empty () )
+	{
+		traceFile = "incidencies-mobility-cache-check.tcl";
+		std::ofstream sample (traceFile.c_str ());
+		sample << SAMPLE_TRACE;
+	}
+
+	if ( !Ns2MobilityCache::Compile (traceFile, cacheFile) )
+	{
+		std::cerr << "Unable to compile " << traceFile << " into " << cacheFile << std::endl;
+		return 1;
+	}
+	Ns2MobilityCache cache (traceFile, cacheFile);
+	if ( !cache.Load () )
+	{
+		std::cerr << "Unable to load mobility cache " << cacheFile << std::endl;
+		return 1;
+	}
+
+	CheckContext context;
+	context.maxError = 0.;
+	context.maxErrorTime = 0.;
+	context.maxErrorNode = 0;
+
+	// The cache installs on NodeList ids 0..n-1, the helper on the range given
+	context.cached.Create (cache.GetNNodes ());
+	cache.Install ();
+	context.reference.Create (cache.GetNNodes ());
+	Ns2MobilityHelper ns2 (traceFile);
+	ns2.Install (context.reference.Begin (), context.reference.End ());
+
+	// Off the command times by 1 us, where the cached jumps (1 ns) are over
+	for ( double t = 0.; t <= duration; t += step )
+	{
+		Simulator::Schedule (Seconds (t) + MicroSeconds (1), &Compare, &context);
+	}
+	Simulator::Stop (Seconds (duration + 1.));
+	Simulator::Run ();
+	Simulator::Destroy ();
+
+	std::cout << "nodes: " << cache.GetNNodes () << ", largest error: " << context.maxError << " m";
+	if ( context.maxError > 0. )
+	{
+		std::cout << " (node " << context.maxErrorNode << " at " << context.maxErrorTime << "s)";
+	}
+	std::cout << std::endl;
+
+	if ( context.maxError > tolerance )
+	{
+		std::cerr << "FAIL: positions differ by more than " << tolerance << " m" << std::endl;
+		return 1;
+	}
+	return 0;
+}
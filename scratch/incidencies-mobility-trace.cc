@@ -34,14 +34,13 @@ using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE ("IncidenciesMobilityTrace");
 
-std::vector<double> currentReputationValues;
 double bias = .9;
-uint32_t	generatedEvents = 0;
+Ptr<UniformRandomVariable>	scenarioRandom;	// Node roles, trusted nodes and incident generators
 
 double
 RandomNumberUniform ()
 {
-	return drand48 ();
+	return scenarioRandom->GetValue ();
 }
 
 double
@@ -58,28 +57,10 @@ TossBiasedCoin (double bias)
 	return accept;
 }
 
-uint32_t
-GetNodeNumFromContext (std::string context)
-{
-	std::vector<std::string> elements;
-	std::stringstream ss (context);
-	std::string item;
-
-	while (std::getline (ss, item, '/')) {
-		elements.push_back (item);
-	}
-
-	std::stringstream toInteger (elements.at (2));
-	uint32_t nodeId;
-	toInteger >> nodeId;
-
-	return nodeId;
-}
-
 uint32_t
 GetRandomNode (int maxNodes)
 {
-	return (int) maxNodes * drand48 ();
+	return (int) maxNodes * RandomNumberUniform ();
 }
 
 void
@@ -122,31 +103,39 @@ SelectTrustedNodes (NodeContainer *n, double trustedNodes)
 }
 
 void
-ReputationValueTrace (std::string context, double oldValue, double newValue)
+DumpReputationValues (Ptr<ReputationTraceWriter> writer, Ptr<ReputationMonitor> reputation,
+		Ptr<IncidentScheduler> incidents, double nextDumpDelay)
 {
-//	NS_LOG_INFO (Simulator::Now() << " " << context << " old reputation value or= " <<
-//			oldValue << ", new reputation value nr= " << newValue);
-
-//	NS_LOG_INFO (Simulator::Now ().GetSeconds () << " " << GetNodeNumFromContext (context) << " " << newValue);
-	currentReputationValues[GetNodeNumFromContext (context)] = newValue;
+	writer->WriteFrame (Simulator::Now (), incidents->GetGeneratedIncidents (), reputation->GetReputationValues ());
+	Simulator::Schedule (Seconds (nextDumpDelay), &DumpReputationValues, writer, reputation, incidents, nextDumpDelay);
 }
 
-void
-DumpReputationValues (std::ostream *os, double nextDumpDelay)
+/*
+ * Creates the reputation trace backend: 'csv' (default), 'binary' or
+ * 'changelog'.
+ */
+Ptr<ReputationTraceWriter>
+CreateReputationTraceWriter (std::string format, uint32_t precision, std::string compression,
+		uint32_t keyframeInterval)
 {
-	std::stringstream dumpStream;
-	dumpStream << generatedEvents << ",";
-	for (unsigned int i = 0; i < currentReputationValues.size (); i++)
+	ObjectFactory factory;
+	if ( format == "binary" )
+	{
+		factory.SetTypeId ("ns3::BinaryReputationTraceWriter");
+		factory.Set ("Precision", UintegerValue (precision));
+		factory.Set ("Compression", StringValue (compression));
+	}
+	else if ( format == "changelog" )
 	{
-		if ( i == (currentReputationValues.size () - 1) )
-			dumpStream << currentReputationValues.at (i);
-		else
-			dumpStream << currentReputationValues.at (i) << ",";
+		factory.SetTypeId ("ns3::ChangeLogReputationTraceWriter");
+		factory.Set ("KeyframeInterval", UintegerValue (keyframeInterval));
+	}
+	else
+	{
+		factory.SetTypeId ("ns3::CsvReputationTraceWriter");
 	}
 
-//	NS_LOG_INFO (dumpStream.str ());
-	*os << dumpStream.str () << "\n";
-	Simulator::Schedule (Seconds (nextDumpDelay), &DumpReputationValues, os, nextDumpDelay);
+	return factory.Create<ReputationTraceWriter> ();
 }
 
 void
@@ -175,21 +164,6 @@ DumpNodeInfo (NodeContainer n, std::string filename)
 	networkTopology.close();
 }
 
-void
-NewEvent (NodeContainer container, double eventGenDelay)
-{
-	uint32_t genNode = GetRandomNode (container.GetN ());
-	Ptr<Node> selectedNode = container.Get (genNode);
-
-//	NS_LOG_INFO ("At time " << Simulator::Now() << " Node " << selectedNode->GetId () << " was selected.");
-
-	Ptr<IncidentGenerator> genApp = selectedNode->GetApplication (1)->GetObject<IncidentGenerator> ();
-	genApp->GenerateNewIncident (Seconds (0.0));
-	generatedEvents++;
-
-	Simulator::Schedule(Seconds (eventGenDelay), &NewEvent, container, eventGenDelay);
-}
-
 int main (int argc, char *argv[])
 {
 	// Enable logging from the ns2 helper
@@ -199,6 +173,7 @@ int main (int argc, char *argv[])
 	std::string 	paramsFile;
 //	std::string		traceFilePath = "/home/cristian/apps/bonnmotion-2.0/mobility-traces";
 	std::string 	traceFile;
+	std::string		mobilityCacheFile;
 	std::string		outputFile;
 	std::string		reputationTraceFile;
 	std::string		overrideReputationTraceFile;
@@ -221,13 +196,24 @@ int main (int argc, char *argv[])
 	uint32_t		printNetworkTopology = 0;
 	std::string		topologyFile;
 	uint32_t		printLogInfo = 0;
-
-	srand48 (time (0));
+	uint32_t		seed = 1;
+	uint64_t		run = 1;
+	uint64_t		overrideRun = 0;
+	std::string		reputationTraceFormat = "csv";
+	uint32_t		reputationTracePrecision = 64;
+	std::string		reputationTraceCompression = "None";
+	uint32_t		reputationKeyframeInterval = 10;
+	uint32_t		genAnimation = 0;
+	double			animStart = 0.;
+	double			animStop = 0.;				// 0 for the end of the run
+	double			animPollInterval = .25;
+	uint32_t		animPacketMetadata = 0;
 
 	// Parse command line attribute
 	CommandLine cmd;
 	cmd.AddValue ("params", "File containing the parameters for the simulation", paramsFile);
 	cmd.AddValue ("reputationTraceFile", "File containing the reputation traces", overrideReputationTraceFile);
+	cmd.AddValue ("run", "Run number of the random number generator (overrides the params file)", overrideRun);
 //	cmd.AddValue ("traceFile", "Ns2 movement trace file", traceFile);
 //	cmd.AddValue ("outputFile", "Generated animation file", outputFile);
 //	cmd.AddValue ("reputationTraceFile", "Reputation values file", reputationTraceFile);
@@ -261,6 +247,9 @@ int main (int argc, char *argv[])
 			if ( paramName == "traceFile" ) {
 				parse >> traceFile;
 			}
+			else if ( paramName == "mobilityCache" ) {
+				parse >> mobilityCacheFile;
+			}
 			else if ( paramName == "outputFile" ) {
 				parse >> outputFile;
 			}
@@ -324,17 +313,65 @@ int main (int argc, char *argv[])
 			else if ( paramName == "log" ) {
 				parse >> printLogInfo;
 			}
+			else if ( paramName == "seed" ) {
+				parse >> seed;
+			}
+			else if ( paramName == "run" ) {
+				parse >> run;
+			}
+			else if ( paramName == "reputationTraceFormat" ) {
+				parse >> reputationTraceFormat;
+			}
+			else if ( paramName == "reputationTracePrecision" ) {
+				parse >> reputationTracePrecision;
+			}
+			else if ( paramName == "reputationTraceCompression" ) {
+				parse >> reputationTraceCompression;
+			}
+			else if ( paramName == "reputationKeyframeInterval" ) {
+				parse >> reputationKeyframeInterval;
+			}
+			else if ( paramName == "anim" ) {
+				parse >> genAnimation;
+			}
+			else if ( paramName == "animStart" ) {
+				parse >> animStart;
+			}
+			else if ( paramName == "animStop" ) {
+				parse >> animStop;
+			}
+			else if ( paramName == "animPollInterval" ) {
+				parse >> animPollInterval;
+			}
+			else if ( paramName == "animPacketMetadata" ) {
+				parse >> animPacketMetadata;
+			}
 		}
 	}
 	params.close ();
 
 	if ( !overrideReputationTraceFile.empty () ) reputationTraceFile = overrideReputationTraceFile;
+	if ( overrideRun != 0 ) run = overrideRun;
+
+	// Every stochastic decision draws from ns-3 streams, so a (seed, run) pair
+	// fully determines the simulation
+	RngSeedManager::SetSeed (seed);
+	RngSeedManager::SetRun (run);
+
+	int64_t stream = 0;
+	scenarioRandom = CreateObject<UniformRandomVariable> ();
+	scenarioRandom->SetStream (stream++);
 
 	if ( printLogInfo == 1 )
 	{
 		LogComponentEnable ("IncidentGeneratorApplication", LOG_LEVEL_INFO);
 		LogComponentEnable ("IncidentSinkApplication", LOG_LEVEL_INFO);
 		LogComponentEnable ("IncidenciesMobilityTrace", LOG_LEVEL_INFO);
+
+		// The applications record their activity as events, printed in the
+		// text format they used to log
+		IncidentEventLog::SetMask (IncidentEventLog::ALL);
+		IncidentEventLog::SetEcho (&std::clog);
 	}
 
 //	traceFilePath.append (traceFile);
@@ -372,7 +409,21 @@ int main (int argc, char *argv[])
 	allNodes.Add (maliciousNodes);
 	allNodes.Add (randomNodes);
 
-	ns2.Install (); // configure movements for each node, while reading trace file
+	if ( !mobilityCacheFile.empty () )
+	{
+		// Compiled form of the trace, rebuilt automatically when it is stale
+		Ns2MobilityCache mobilityCache (traceFile, mobilityCacheFile);
+		if ( !mobilityCache.Load () )
+		{
+			std::cerr << "Unable to load mobility cache " << mobilityCacheFile << std::endl;
+			return 1;
+		}
+		mobilityCache.Install ();
+	}
+	else
+	{
+		ns2.Install (); // configure movements for each node, while reading trace file
+	}
 
 	InternetStackHelper internet;
 	internet.Install (allNodes);
@@ -422,37 +473,63 @@ int main (int argc, char *argv[])
 	ApplicationContainer generatorApps = incidentGen.Install (allNodes);
 	generatorApps.Start (Seconds (1.0));
 
-	Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+	stream += incidentSink.AssignStreams (allNodes, stream);
+	stream += incidentGen.AssignStreams (allNodes, stream);
 
-	// Initialize current reputation array with the initial values for all the nodes
-	for (unsigned int i = 0; i < allNodes.GetN (); i++)
-	{
-		DoubleValue rep; allNodes.Get (i)->GetAttribute("Reputation", rep);
-		currentReputationValues.push_back(rep.Get ());
-	}
+	// Dispatches the incidents to the IncidentGenerator applications
+	Ptr<IncidentScheduler> incidents = CreateObject<IncidentScheduler> ();
+	incidents->SetNodes (allNodes);
+	stream += incidents->AssignStreams (stream);
+
+	Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
-	// Define traceback call for changes in the reputation value
-	Config::Connect ("/NodeList/*/Reputation", MakeCallback (&ReputationValueTrace));
+	// Follow the reputation of all the nodes, starting from their initial values
+	Ptr<ReputationMonitor> reputation = CreateObject<ReputationMonitor> ();
+	reputation->Install (allNodes);
 
 	if ( printNetworkTopology == 1 ) // Print network topology if indicated
 		DumpNodeInfo (allNodes, topologyFile);
 
-	std::ofstream repFile (reputationTraceFile.c_str ());
+	// Role of every node, in allNodes order, for the reputation trace header
+	std::vector<uint8_t> roles;
+	roles.insert (roles.end (), numOfSelfishNodes, (uint8_t) ReputationTraceWriter::SELFISH_NODE);
+	roles.insert (roles.end (), numOfAltruisticNodes, (uint8_t) ReputationTraceWriter::ALTRUISTIC_NODE);
+	roles.insert (roles.end (), numOfMaliciousNodes, (uint8_t) ReputationTraceWriter::MALICIOUS_NODE);
+	roles.insert (roles.end (), numOfRandomNodes, (uint8_t) ReputationTraceWriter::RANDOM_NODE);
+
+	Ptr<ReputationTraceWriter> repTrace = CreateReputationTraceWriter (reputationTraceFormat,
+			reputationTracePrecision, reputationTraceCompression, reputationKeyframeInterval);
+	if ( !repTrace->Open (reputationTraceFile, roles) )
+	{
+		std::cerr << "Unable to create reputation trace " << reputationTraceFile << std::endl;
+		return 1;
+	}
+	reputation->SetTraceWriter (repTrace);
 
 	// Print reputation values information
-	Simulator::Schedule (Seconds (1.0), &DumpReputationValues, &repFile, generationInterval);
+	Simulator::Schedule (Seconds (1.0), &DumpReputationValues, repTrace, reputation, incidents, generationInterval);
 
 	// Start generating incidents
-	Simulator::Schedule (Seconds (3.0), &NewEvent, allNodes, generationInterval);
+	incidents->StartRandomIncidents (Seconds (3.0), Seconds (generationInterval));
 
-	// Generate NetAnim XML file
-	if ( !outputFile.empty () )	AnimationInterface animation (outputFile.c_str ());
+	// Generate NetAnim XML file, only with anim=1 (see incidencies-graphml-trace)
+	AnimationInterface *animation = 0;
+	if ( genAnimation == 1 )
+	{
+		animation = new AnimationInterface (outputFile.c_str ());
+		animation->EnablePacketMetadata (animPacketMetadata == 1);
+		animation->SetMobilityPollInterval (Seconds (animPollInterval));
+		animation->SetStartTime (Seconds (animStart));
+		animation->SetStopTime (Seconds (animStop > 0. ? animStop : duration));
+	}
 
 	Simulator::Stop (Seconds (duration));
 	Simulator::Run ();
 	Simulator::Destroy ();
 
-	repFile.close ();
+	delete animation;
+
+	repTrace->Close ();
 
 	return 0;
 }
@@ -0,0 +1,87 @@
+/*
+ * incidencies-reputation-reader.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+/*
+ * Converts a binary reputation trace or change log (reputationTraceFormat=binary
+ * or changelog) back to the CSV rows the simulations used to write.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/applications-module.h"
+
+#include <fstream>
+#include <iostream>
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+	std::string		inputFile;
+	std::string		outputFile;
+	uint32_t		printTime = 0;
+	uint32_t		printRoles = 0;
+	double			from = -1.;
+
+	CommandLine cmd;
+	cmd.AddValue ("input", "Binary reputation trace", inputFile);
+	cmd.AddValue ("output", "CSV file to write (standard output if empty)", outputFile);
+	cmd.AddValue ("time", "Prefix every row with the frame time", printTime);
+	cmd.AddValue ("roles", "Print the role of every node before the frames", printRoles);
+	cmd.AddValue ("from", "Start at the last keyframe at or before this time (seconds)", from);
+	cmd.Parse (argc, argv);
+
+	ReputationTraceReader reader;
+	if ( !reader.Open (inputFile) )
+	{
+		std::cerr << "Unable to read reputation trace " << inputFile << std::endl;
+		return 1;
+	}
+
+	std::ofstream file;
+	if ( !outputFile.empty () ) file.open (outputFile.c_str ());
+	std::ostream &os = outputFile.empty () ? std::cout : file;
+
+	if ( printRoles == 1 )
+	{
+		// 0 = selfish, 1 = altruistic, 2 = malicious, 3 = random
+		os << "#roles";
+		for ( uint32_t i = 0; i < reader.GetNNodes (); i++ ) os << "," << (uint32_t) reader.GetRole (i);
+		os << "\n";
+	}
+
+	if ( from >= 0 && !reader.Seek (from) )
+	{
+		std::cerr << "No keyframe at or before " << from << "s, reading from the start" << std::endl;
+	}
+
+	double time;
+	uint32_t generatedIncidents;
+	std::vector<double> reputation;
+	while ( reader.ReadFrame (time, generatedIncidents, reputation) )
+	{
+		if ( printTime == 1 ) os << time << ",";
+		os << generatedIncidents;
+		for ( unsigned int i = 0; i < reputation.size (); i++ ) os << "," << reputation[i];
+		os << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * incidencies-schedule-converter.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+/*
+ * Converts an ns-2 style event list (eventListFile parameter of the
+ * simulations) to its binary form, which IncidentScheduleReader reads
+ * without parsing. The binary file can be given as eventListFile in place
+ * of the text one.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/applications-module.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+	std::string		inputFile;
+	std::string		outputFile;
+
+	CommandLine cmd;
+	cmd.AddValue ("input", "Text event list", inputFile);
+	cmd.AddValue ("output", "Binary event list to write", outputFile);
+	cmd.Parse (argc, argv);
+
+	if ( outputFile.empty () )
+	{
+		std::cerr << "No output file given" << std::endl;
+		return 1;
+	}
+
+	if ( !IncidentScheduleReader::ConvertToBinary (inputFile, outputFile) )
+	{
+		std::cerr << "Unable to convert event list " << inputFile << " into " << outputFile << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -23,6 +23,7 @@
 #include "ns3/names.h"
 #include "ns3/incident-generator-application.h"
 #include "ns3/incident-sink-application.h"
+#include "ns3/incidencies-registry.h"
 
 #include "incidencies-helper.h"
 
@@ -69,11 +70,32 @@ IncidentSinkHelper::Install(NodeContainer c) const
 	return apps;
 }
 
+int64_t
+IncidentSinkHelper::AssignStreams (NodeContainer c, int64_t stream)
+{
+	int64_t currentStream = stream;
+	for ( NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+	{
+		Ptr<Node> node = *i;
+		for ( uint32_t j = 0; j < node->GetNApplications (); j++ )
+		{
+			Ptr<IncidentSink> sink = DynamicCast<IncidentSink> (node->GetApplication (j));
+			if ( sink )
+			{
+				currentStream += sink->AssignStreams (currentStream);
+			}
+		}
+	}
+
+	return (currentStream - stream);
+}
+
 Ptr<Application>
 IncidentSinkHelper::InstallPriv (Ptr<Node> node) const
 {
-  Ptr<Application> app = m_factory.Create<IncidentSink> ();
+  Ptr<IncidentSink> app = m_factory.Create<IncidentSink> ();
   node->AddApplication (app);
+  IncidenciesRegistry::AddSink (node->GetId (), app);
 
   return app;
 }
@@ -119,11 +141,32 @@ IncidentGeneratorHelper::Install(NodeContainer c) const
 	return apps;
 }
 
+int64_t
+IncidentGeneratorHelper::AssignStreams (NodeContainer c, int64_t stream)
+{
+	int64_t currentStream = stream;
+	for ( NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+	{
+		Ptr<Node> node = *i;
+		for ( uint32_t j = 0; j < node->GetNApplications (); j++ )
+		{
+			Ptr<IncidentGenerator> generator = DynamicCast<IncidentGenerator> (node->GetApplication (j));
+			if ( generator )
+			{
+				currentStream += generator->AssignStreams (currentStream);
+			}
+		}
+	}
+
+	return (currentStream - stream);
+}
+
 Ptr<Application>
 IncidentGeneratorHelper::InstallPriv (Ptr<Node> node) const
 {
-  Ptr<Application> app = m_factory.Create<IncidentGenerator> ();
+  Ptr<IncidentGenerator> app = m_factory.Create<IncidentGenerator> ();
   node->AddApplication (app);
+  IncidenciesRegistry::Add (node->GetId (), app);
 
   return app;
 }
@@ -40,6 +40,16 @@ public:
 	ApplicationContainer Install (std::string nodeName) const;
 	ApplicationContainer Install (NodeContainer c) const;
 
+	/**
+	 * Assign fixed random variable stream numbers to the random variables
+	 * used by the applications of this kind installed on the given nodes.
+	 *
+	 * \param c NodeContainer of the set of nodes to look for applications
+	 * \param stream first stream index to use
+	 * \return the number of stream indices assigned
+	 */
+	int64_t AssignStreams (NodeContainer c, int64_t stream);
+
 private:
 	Ptr<Application> InstallPriv (Ptr<Node> node) const;
 
@@ -56,6 +66,16 @@ public:
 	ApplicationContainer Install (std::string nodeName) const;
 	ApplicationContainer Install (NodeContainer c) const;
 
+	/**
+	 * Assign fixed random variable stream numbers to the random variables
+	 * used by the applications of this kind installed on the given nodes.
+	 *
+	 * \param c NodeContainer of the set of nodes to look for applications
+	 * \param stream first stream index to use
+	 * \return the number of stream indices assigned
+	 */
+	int64_t AssignStreams (NodeContainer c, int64_t stream);
+
 private:
 	Ptr<Application> InstallPriv (Ptr<Node> node) const;
 
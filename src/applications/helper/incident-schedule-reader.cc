@@ -0,0 +1,335 @@
+/*
+ * incident-schedule-reader.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include "incident-schedule-reader.h"
+
+NS_LOG_COMPONENT_DEFINE ("IncidentScheduleReader");
+
+namespace ns3 {
+
+static const char SCHEDULE_MAGIC[8] = { 'I', 'N', 'C', 'E', 'V', 'T', '0', '1' };
+
+struct BinaryScheduleHeader
+{
+	char		magic[8];		// "INCEVT01"
+	uint64_t	recordCount;
+};
+
+static const char *
+FindToken (const char *begin, const char *end, const char *token, size_t length)
+{
+	while ( begin + length <= end )
+	{
+		const char *candidate = static_cast<const char *> (memchr (begin, token[0], end - begin - length + 1));
+		if ( candidate == 0 ) return 0;
+		if ( memcmp (candidate, token, length) == 0 ) return candidate;
+		begin = candidate + 1;
+	}
+	return 0;
+}
+
+/*
+ * Parses the number starting at 'p' (after optional blanks) without reading
+ * past 'end'. The digits are copied to a small stack buffer because strtod
+ * needs a terminated string and the mapped file is not.
+ */
+static bool
+ParseNumber (const char *&p, const char *end, double &value)
+{
+	while ( p < end && (*p == ' ' || *p == '\t') ) p++;
+
+	char buffer[64];
+	size_t n = 0;
+	while ( p + n < end && n < sizeof (buffer) - 1 && strchr ("0123456789+-.eE", p[n]) != 0 && p[n] != '\0' )
+	{
+		buffer[n] = p[n];
+		n++;
+	}
+	if ( n == 0 ) return false;
+	buffer[n] = '\0';
+
+	char *parsedEnd;
+	value = strtod (buffer, &parsedEnd);
+	if ( parsedEnd == buffer ) return false;
+	p += parsedEnd - buffer;
+	return true;
+}
+
+IncidentScheduleReader::IncidentScheduleReader ()
+	: m_map (0),
+	  m_mapSize (0),
+	  m_cursor (0),
+	  m_end (0),
+	  m_records (0),
+	  m_nRecords (0),
+	  m_nextRecord (0),
+	  m_window (1),
+	  m_pending (0)
+{
+}
+
+IncidentScheduleReader::~IncidentScheduleReader ()
+{
+	Close ();
+}
+
+bool
+IncidentScheduleReader::Open (std::string file)
+{
+	Close ();
+
+	int fd = open (file.c_str (), O_RDONLY);
+	if ( fd < 0 )
+	{
+		NS_LOG_ERROR ("Unable to open incident schedule " << file);
+		return false;
+	}
+
+	struct stat fileStat;
+	if ( fstat (fd, &fileStat) != 0 )
+	{
+		close (fd);
+		return false;
+	}
+
+	if ( fileStat.st_size > 0 )
+	{
+		void *map = mmap (0, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if ( map == MAP_FAILED )
+		{
+			close (fd);
+			return false;
+		}
+		m_map = map;
+		m_mapSize = fileStat.st_size;
+	}
+	close (fd);
+
+	const BinaryScheduleHeader *header = static_cast<const BinaryScheduleHeader *> (m_map);
+	if ( m_mapSize >= sizeof (BinaryScheduleHeader)
+			&& memcmp (header->magic, SCHEDULE_MAGIC, sizeof (SCHEDULE_MAGIC)) == 0 )
+	{
+		if ( m_mapSize != sizeof (BinaryScheduleHeader) + header->recordCount * sizeof (BinaryRecord) )
+		{
+			NS_LOG_ERROR ("Malformed binary incident schedule " << file);
+			Close ();
+			return false;
+		}
+		m_records = reinterpret_cast<const BinaryRecord *> (header + 1);
+		m_nRecords = header->recordCount;
+	}
+
+	SortIfNeeded ();
+	Rewind ();
+	return true;
+}
+
+static bool
+CompareRecordTime (const IncidentScheduleReader::BinaryRecord &a, const IncidentScheduleReader::BinaryRecord &b)
+{
+	return a.time < b.time;
+}
+
+void
+IncidentScheduleReader::SortIfNeeded (void)
+{
+	double time;
+	int32_t nodeId;
+	double last = 0;
+	bool sorted = true;
+	Rewind ();
+	for ( bool first = true; sorted && Next (time, nodeId); first = false )
+	{
+		sorted = first || time >= last;
+		last = time;
+	}
+	if ( sorted ) return;
+
+	BinaryRecord record;
+	memset (&record, 0, sizeof (record));
+	Rewind ();
+	while ( Next (record.time, record.nodeId) ) m_sorted.push_back (record);
+	std::stable_sort (m_sorted.begin (), m_sorted.end (), CompareRecordTime);
+
+	NS_LOG_WARN ("Incident schedule is not sorted by time, sorted its " << m_sorted.size () << " incidents in memory");
+	m_records = &m_sorted[0];
+	m_nRecords = m_sorted.size ();
+}
+
+void
+IncidentScheduleReader::Close (void)
+{
+	if ( m_map != 0 )
+	{
+		munmap (m_map, m_mapSize);
+	}
+	m_map = 0;
+	m_mapSize = 0;
+	m_cursor = 0;
+	m_end = 0;
+	m_records = 0;
+	m_nRecords = 0;
+	m_nextRecord = 0;
+	m_sorted.clear ();
+}
+
+void
+IncidentScheduleReader::Rewind (void)
+{
+	m_nextRecord = 0;
+	if ( m_records == 0 )
+	{
+		m_cursor = static_cast<const char *> (m_map);
+		m_end = m_cursor + m_mapSize;
+	}
+}
+
+bool
+IncidentScheduleReader::Next (double &time, int32_t &nodeId)
+{
+	if ( m_records != 0 )
+	{
+		if ( m_nextRecord >= m_nRecords ) return false;
+		time = m_records[m_nextRecord].time;
+		nodeId = m_records[m_nextRecord].nodeId;
+		++m_nextRecord;
+		return true;
+	}
+
+	return NextText (time, nodeId);
+}
+
+bool
+IncidentScheduleReader::NextText (double &time, int32_t &nodeId)
+{
+	while ( m_cursor < m_end )
+	{
+		const char *line = m_cursor;
+		const char *lineEnd = static_cast<const char *> (memchr (line, '\n', m_end - line));
+		if ( lineEnd == 0 ) lineEnd = m_end;
+		m_cursor = lineEnd < m_end ? lineEnd + 1 : m_end;
+
+		// We only process the lines that contain '$ns_ at <time> "$node_(<id>)'
+		const char *p = FindToken (line, lineEnd, "$ns_ at", 7);
+		if ( p == 0 ) continue;
+		p += 7;
+		if ( !ParseNumber (p, lineEnd, time) ) continue;
+
+		p = FindToken (p, lineEnd, "$node_(", 7);
+		if ( p == 0 ) continue;
+		p += 7;
+		double id;
+		if ( !ParseNumber (p, lineEnd, id) ) continue;
+		nodeId = (int32_t) id;
+
+		return true;
+	}
+
+	return false;
+}
+
+void
+IncidentScheduleReader::Start (DispatchCallback dispatch, uint32_t window)
+{
+	m_dispatch = dispatch;
+	m_window = window > 0 ? window : 1;
+	m_pending = 0;
+	Refill ();
+}
+
+void
+IncidentScheduleReader::Refill (void)
+{
+	double time;
+	int32_t nodeId;
+	while ( m_pending < m_window && Next (time, nodeId) )
+	{
+		if ( nodeId < 0 ) continue;
+
+		Time at = Seconds (time);
+		Time delay = at > Simulator::Now () ? at - Simulator::Now () : Seconds (0);
+		if ( at < Simulator::Now () )
+		{
+			// Only if started after the first incidents
+			NS_LOG_WARN ("Incident at " << time << "s is in the past, delivered at "
+					<< Simulator::Now ().GetSeconds () << "s");
+		}
+
+		Simulator::Schedule (delay, &IncidentScheduleReader::Fire, this, (uint32_t) nodeId);
+		++m_pending;
+	}
+}
+
+void
+IncidentScheduleReader::Fire (uint32_t nodeId)
+{
+	--m_pending;
+	m_dispatch (nodeId);
+	Refill ();
+}
+
+bool
+IncidentScheduleReader::ConvertToBinary (std::string textFile, std::string binaryFile)
+{
+	IncidentScheduleReader reader;
+	if ( !reader.Open (textFile) ) return false;
+
+	FILE *out = fopen (binaryFile.c_str (), "wb");
+	if ( out == 0 )
+	{
+		NS_LOG_ERROR ("Unable to create binary incident schedule " << binaryFile);
+		return false;
+	}
+
+	BinaryScheduleHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, SCHEDULE_MAGIC, sizeof (header.magic));
+	bool ok = fwrite (&header, sizeof (header), 1, out) == 1;
+
+	BinaryRecord record;
+	memset (&record, 0, sizeof (record));
+	while ( ok && reader.Next (record.time, record.nodeId) )
+	{
+		ok = fwrite (&record, sizeof (record), 1, out) == 1;
+		++header.recordCount;
+	}
+
+	// Patch the record count now that it is known
+	ok = ok && fseek (out, 0, SEEK_SET) == 0 && fwrite (&header, sizeof (header), 1, out) == 1;
+	ok = (fclose (out) == 0) && ok;
+	return ok;
+}
+
+} // namespace ns3
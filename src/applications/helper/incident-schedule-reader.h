@@ -0,0 +1,124 @@
+/*
+ * incident-schedule-reader.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef INCIDENT_SCHEDULE_READER_H_
+#define INCIDENT_SCHEDULE_READER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ns3/callback.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Streams an incident schedule into the simulator.
+ *
+ * The schedule is either an ns-2 style event list, where every line
+ * containing '$ns_ at <time> "$node_(<id>)' is an incident, or its binary
+ * form (see ConvertToBinary). The file is memory-mapped and tokenized in
+ * place, without copying lines.
+ *
+ * Start () keeps only the next 'window' incidents scheduled; every time one
+ * of them fires, the next incident of the file is read and scheduled. This
+ * needs the schedule sorted by time, which Open checks in one pass over the
+ * file; an unsorted schedule is sorted in memory instead (incidents of the
+ * same time keep their order), so it is generated as if every incident had
+ * been scheduled upfront.
+ */
+class IncidentScheduleReader
+{
+public:
+	typedef Callback<void, uint32_t> DispatchCallback;
+
+	IncidentScheduleReader ();
+	~IncidentScheduleReader ();
+
+	/**
+	 * Maps 'file', detecting whether it is a text or a binary schedule.
+	 */
+	bool Open (std::string file);
+
+	/**
+	 * \param time time of the next incident, in seconds
+	 * \param nodeId node generating the next incident
+	 * \returns false at the end of the schedule
+	 */
+	bool Next (double &time, int32_t &nodeId);
+
+	/**
+	 * Goes back to the first incident of the schedule.
+	 */
+	void Rewind (void);
+
+	/**
+	 * Starts feeding the simulator from the current position: 'dispatch' is
+	 * called with the node id at the time of every incident, and at most
+	 * 'window' incidents are pending in the event queue at any time.
+	 * Incidents of negative node ids are skipped.
+	 */
+	void Start (DispatchCallback dispatch, uint32_t window);
+
+	/**
+	 * Writes the incidents of the text schedule 'textFile' to 'binaryFile'.
+	 */
+	static bool ConvertToBinary (std::string textFile, std::string binaryFile);
+
+	struct BinaryRecord
+	{
+		double		time;
+		int32_t		nodeId;
+		uint32_t	reserved;
+	};
+
+private:
+	IncidentScheduleReader (const IncidentScheduleReader &);
+	IncidentScheduleReader &operator = (const IncidentScheduleReader &);
+
+	void Close (void);
+	void SortIfNeeded (void);
+	bool NextText (double &time, int32_t &nodeId);
+	void Refill (void);
+	void Fire (uint32_t nodeId);
+
+	void				*m_map;
+	size_t				m_mapSize;
+
+	const char			*m_cursor;		// Text schedule: next unread byte
+	const char			*m_end;
+
+	const BinaryRecord	*m_records;		// Binary schedule, or m_sorted
+	uint64_t			m_nRecords;
+	uint64_t			m_nextRecord;
+	std::vector<BinaryRecord>	m_sorted;	// The incidents of an unsorted schedule
+
+	DispatchCallback	m_dispatch;
+	uint32_t			m_window;
+	uint32_t			m_pending;		// Incidents currently in the event queue
+};
+
+} // namespace ns3
+
+
+#endif /* INCIDENT_SCHEDULE_READER_H_ */
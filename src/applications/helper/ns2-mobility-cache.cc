@@ -0,0 +1,425 @@
+/*
+ * ns2-mobility-cache.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/waypoint.h"
+#include "ns3/waypoint-mobility-model.h"
+
+#include "ns2-mobility-cache.h"
+
+NS_LOG_COMPONENT_DEFINE ("Ns2MobilityCache");
+
+namespace ns3 {
+
+static const char CACHE_MAGIC[8] = { 'I', 'N', 'C', 'M', 'O', 'B', '0', '2' };
+
+// WaypointMobilityModel wants strictly increasing times, so a timed 'set'
+// moves the node over this long (the time resolution) instead of at once
+static const double JUMP_DURATION = 1e-9;
+
+enum TraceCommand
+{
+	SET_DEST,
+	SET_X,
+	SET_Y,
+	SET_Z
+};
+
+struct TraceEvent
+{
+	double			time;
+	TraceCommand	command;
+	double			args[3];
+};
+
+static bool
+CompareEventTime (const TraceEvent &a, const TraceEvent &b)
+{
+	return a.time < b.time;
+}
+
+/*
+ * Makes the last waypoint of 'w' lie exactly at time 't': it either adds a
+ * waypoint holding the last position (the node was stopped) or cuts the
+ * segment in progress at its position at 't'.
+ */
+static void
+TruncateAt (std::vector<Ns2MobilityCache::Record> &w, double t)
+{
+	Ns2MobilityCache::Record &last = w.back ();
+	if ( last.time <= t )
+	{
+		if ( last.time < t )
+		{
+			Ns2MobilityCache::Record hold = last;
+			hold.time = t;
+			hold.speed = 0;
+			w.push_back (hold);
+		}
+		return;
+	}
+
+	const Ns2MobilityCache::Record &prev = w[w.size () - 2];
+	if ( prev.time == t )
+	{
+		// Cut at its start, the segment is gone
+		w.pop_back ();
+		return;
+	}
+
+	double f = (t - prev.time) / (last.time - prev.time);
+	last.x = prev.x + f * (last.x - prev.x);
+	last.y = prev.y + f * (last.y - prev.y);
+	last.z = prev.z + f * (last.z - prev.z);
+	last.time = t;
+}
+
+Ns2MobilityCache::Ns2MobilityCache (std::string traceFile, std::string cacheFile)
+	: m_traceFile (traceFile),
+	  m_cacheFile (cacheFile),
+	  m_map (0),
+	  m_mapSize (0),
+	  m_header (0),
+	  m_offsets (0),
+	  m_records (0)
+{
+}
+
+Ns2MobilityCache::~Ns2MobilityCache ()
+{
+	Unmap ();
+}
+
+bool
+Ns2MobilityCache::Load (void)
+{
+	if ( Map () && !IsStale () ) return true;
+
+	NS_LOG_INFO ("Compiling mobility trace " << m_traceFile << " into " << m_cacheFile);
+	Unmap ();
+	if ( !Compile (m_traceFile, m_cacheFile) ) return false;
+	return Map ();
+}
+
+void
+Ns2MobilityCache::Install (void) const
+{
+	NS_ASSERT_MSG (m_header != 0, "Ns2MobilityCache::Load () must be called before Install ()");
+
+	for ( uint32_t i = 0; i < m_header->nodeCount && i < NodeList::GetNNodes (); i++ )
+	{
+		uint64_t first = m_offsets[i];
+		uint64_t last = m_offsets[i + 1];
+		if ( first == last ) continue;
+
+		Ptr<Node> node = NodeList::GetNode (i);
+		Ptr<WaypointMobilityModel> model = node->GetObject<WaypointMobilityModel> ();
+		if ( model == 0 )
+		{
+			model = CreateObject<WaypointMobilityModel> ();
+			node->AggregateObject (model);
+		}
+
+		for ( uint64_t r = first; r < last; r++ )
+		{
+			const Record &record = m_records[r];
+			model->AddWaypoint (Waypoint (Seconds (record.time), Vector (record.x, record.y, record.z)));
+		}
+	}
+}
+
+uint32_t
+Ns2MobilityCache::GetNNodes (void) const
+{
+	return m_header == 0 ? 0 : m_header->nodeCount;
+}
+
+bool
+Ns2MobilityCache::Compile (std::string traceFile, std::string cacheFile)
+{
+	std::ifstream trace (traceFile.c_str ());
+	if ( !trace.is_open () )
+	{
+		NS_LOG_ERROR ("Unable to open mobility trace " << traceFile);
+		return false;
+	}
+
+	std::vector<std::vector<TraceEvent> > events;
+	std::vector<Vector> initial;
+	std::vector<bool> present;
+
+	std::string line;
+	while ( std::getline (trace, line) )
+	{
+		// "$node_(N) set X_ x" or "$ns_ at t "$node_(N) setdest x y speed""
+		std::replace (line.begin (), line.end (), '"', ' ');
+		std::replace (line.begin (), line.end (), '(', ' ');
+		std::replace (line.begin (), line.end (), ')', ' ');
+		std::istringstream tokens (line);
+
+		std::string token;
+		bool timed = false;
+		double time = 0;
+		if ( !(tokens >> token) ) continue;
+		if ( token == "$ns_" )
+		{
+			std::string at;
+			if ( !(tokens >> at >> time >> token) || at != "at" ) continue;
+			timed = true;
+		}
+		if ( token != "$node_" ) continue;
+
+		uint32_t nodeId;
+		std::string command;
+		if ( !(tokens >> nodeId >> command) ) continue;
+
+		if ( nodeId >= events.size () )
+		{
+			events.resize (nodeId + 1);
+			initial.resize (nodeId + 1, Vector (0, 0, 0));
+			present.resize (nodeId + 1, false);
+		}
+		present[nodeId] = true;
+
+		TraceEvent event;
+		event.time = time;
+		if ( command == "setdest" )
+		{
+			if ( !(tokens >> event.args[0] >> event.args[1] >> event.args[2]) ) continue;
+			event.command = SET_DEST;
+		}
+		else if ( command == "set" )
+		{
+			std::string coordinate;
+			if ( !(tokens >> coordinate >> event.args[0]) ) continue;
+			if ( coordinate == "X_" ) event.command = SET_X;
+			else if ( coordinate == "Y_" ) event.command = SET_Y;
+			else if ( coordinate == "Z_" ) event.command = SET_Z;
+			else continue;
+
+			if ( !timed )
+			{
+				if ( event.command == SET_X ) initial[nodeId].x = event.args[0];
+				else if ( event.command == SET_Y ) initial[nodeId].y = event.args[0];
+				else initial[nodeId].z = event.args[0];
+				continue;
+			}
+		}
+		else
+		{
+			continue;
+		}
+
+		events[nodeId].push_back (event);
+	}
+	trace.close ();
+
+	// Replay every node's commands into its waypoint list
+	std::vector<uint64_t> offsets (events.size () + 1, 0);
+	std::vector<Record> records;
+	for ( uint32_t i = 0; i < events.size (); i++ )
+	{
+		offsets[i] = records.size ();
+		if ( !present[i] ) continue;
+
+		std::vector<TraceEvent> &nodeEvents = events[i];
+		std::stable_sort (nodeEvents.begin (), nodeEvents.end (), CompareEventTime);
+
+		std::vector<Record> waypoints;
+		Record start = { 0, initial[i].x, initial[i].y, initial[i].z, 0 };
+		waypoints.push_back (start);
+		double landed = 0;		// End of the last jump; later commands of its time start there
+
+		for ( std::vector<TraceEvent>::const_iterator e = nodeEvents.begin (); e != nodeEvents.end (); ++e )
+		{
+			if ( e->time < 0 ) continue;
+			double t = std::max (e->time, landed);
+			TruncateAt (waypoints, t);
+			Record next = waypoints.back ();
+
+			if ( e->command == SET_DEST )
+			{
+				double dx = e->args[0] - next.x;
+				double dy = e->args[1] - next.y;
+				double distance = std::sqrt (dx * dx + dy * dy);
+				double speed = e->args[2];
+				if ( speed <= 0 || distance == 0 ) continue;
+
+				next.time = t + distance / speed;
+				next.x = e->args[0];
+				next.y = e->args[1];
+				next.speed = speed;
+				waypoints.push_back (next);
+				continue;
+			}
+
+			// Simultaneous sets, or sets at the start, go into the same waypoint
+			Record &target = (t == landed || waypoints.size () == 1) ? waypoints.back () : next;
+			if ( e->command == SET_X ) target.x = e->args[0];
+			else if ( e->command == SET_Y ) target.y = e->args[0];
+			else target.z = e->args[0];
+			target.speed = 0;
+
+			if ( &target == &next )
+			{
+				next.time = t + JUMP_DURATION;
+				landed = next.time;
+				waypoints.push_back (next);
+			}
+		}
+
+		records.insert (records.end (), waypoints.begin (), waypoints.end ());
+	}
+	offsets[events.size ()] = records.size ();
+
+	FileHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, CACHE_MAGIC, sizeof (header.magic));
+	header.traceHash = HashFile (traceFile);
+	struct stat traceStat;
+	header.traceSize = stat (traceFile.c_str (), &traceStat) == 0 ? traceStat.st_size : 0;
+	header.nodeCount = events.size ();
+	header.recordCount = records.size ();
+
+	FILE *out = fopen (cacheFile.c_str (), "wb");
+	if ( out == 0 )
+	{
+		NS_LOG_ERROR ("Unable to create mobility cache " << cacheFile);
+		return false;
+	}
+	bool ok = fwrite (&header, sizeof (header), 1, out) == 1;
+	ok = ok && fwrite (&offsets[0], sizeof (uint64_t), offsets.size (), out) == offsets.size ();
+	if ( !records.empty () )
+	{
+		ok = ok && fwrite (&records[0], sizeof (Record), records.size (), out) == records.size ();
+	}
+	ok = (fclose (out) == 0) && ok;
+
+	NS_LOG_INFO ("Compiled " << header.nodeCount << " nodes and " << header.recordCount << " waypoints");
+	return ok;
+}
+
+uint64_t
+Ns2MobilityCache::HashFile (std::string file)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	FILE *in = fopen (file.c_str (), "rb");
+	if ( in == 0 ) return 0;
+
+	std::vector<unsigned char> buffer (1 << 20);
+	size_t n;
+	while ( (n = fread (&buffer[0], 1, buffer.size (), in)) > 0 )
+	{
+		for ( size_t i = 0; i < n; i++ )
+		{
+			hash ^= buffer[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	fclose (in);
+
+	return hash;
+}
+
+bool
+Ns2MobilityCache::Map (void)
+{
+	if ( m_map != 0 ) return true;
+
+	int fd = open (m_cacheFile.c_str (), O_RDONLY);
+	if ( fd < 0 ) return false;
+
+	struct stat cacheStat;
+	if ( fstat (fd, &cacheStat) != 0 || (size_t) cacheStat.st_size < sizeof (FileHeader) )
+	{
+		close (fd);
+		return false;
+	}
+
+	void *map = mmap (0, cacheStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	if ( map == MAP_FAILED ) return false;
+
+	m_map = map;
+	m_mapSize = cacheStat.st_size;
+	m_header = static_cast<const FileHeader *> (m_map);
+
+	size_t expected = sizeof (FileHeader) + (m_header->nodeCount + 1) * sizeof (uint64_t)
+			+ m_header->recordCount * sizeof (Record);
+	if ( memcmp (m_header->magic, CACHE_MAGIC, sizeof (CACHE_MAGIC)) != 0 || expected != m_mapSize )
+	{
+		NS_LOG_WARN ("Ignoring malformed mobility cache " << m_cacheFile);
+		Unmap ();
+		return false;
+	}
+
+	m_offsets = reinterpret_cast<const uint64_t *> (m_header + 1);
+	m_records = reinterpret_cast<const Record *> (m_offsets + m_header->nodeCount + 1);
+	return true;
+}
+
+void
+Ns2MobilityCache::Unmap (void)
+{
+	if ( m_map != 0 )
+	{
+		munmap (m_map, m_mapSize);
+	}
+	m_map = 0;
+	m_mapSize = 0;
+	m_header = 0;
+	m_offsets = 0;
+	m_records = 0;
+}
+
+bool
+Ns2MobilityCache::IsStale (void) const
+{
+	struct stat traceStat;
+	if ( stat (m_traceFile.c_str (), &traceStat) != 0 )
+	{
+		// Only the cache is available, trust it
+		return false;
+	}
+
+	if ( (uint64_t) traceStat.st_size != m_header->traceSize ) return true;
+	return HashFile (m_traceFile) != m_header->traceHash;
+}
+
+} // namespace ns3
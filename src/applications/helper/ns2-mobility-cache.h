@@ -0,0 +1,126 @@
+/*
+ * ns2-mobility-cache.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef NS2_MOBILITY_CACHE_H_
+#define NS2_MOBILITY_CACHE_H_
+
+#include <stdint.h>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Compiled, memory-mappable form of an ns-2 mobility trace.
+ *
+ * Compile () parses a BonnMotion/ns-2 trace once ('set X_/Y_/Z_' and
+ * 'setdest' commands) and writes, for every node, the sorted array of
+ * waypoints (time, x, y, z, speed) that the node goes through. Install ()
+ * maps that file and gives every node of the NodeList a
+ * WaypointMobilityModel with the same trajectory, without any text parsing.
+ *
+ * The cache stores a hash of the trace contents; Load () recompiles it
+ * automatically when it is missing or does not match the trace anymore.
+ */
+class Ns2MobilityCache
+{
+public:
+	/**
+	 * \param traceFile ns-2 mobility trace
+	 * \param cacheFile compiled form of traceFile
+	 */
+	Ns2MobilityCache (std::string traceFile, std::string cacheFile);
+	~Ns2MobilityCache ();
+
+	/**
+	 * Maps the cache file, compiling it first if it is missing or stale.
+	 *
+	 * \returns false if the cache could neither be compiled nor mapped
+	 */
+	bool Load (void);
+
+	/**
+	 * Installs a WaypointMobilityModel on every node of the NodeList that
+	 * appears in the trace, like Ns2MobilityHelper::Install does. Load ()
+	 * must have succeeded before.
+	 */
+	void Install (void) const;
+
+	/**
+	 * \returns the number of nodes in the compiled trace
+	 */
+	uint32_t GetNNodes (void) const;
+
+	/**
+	 * Compiles 'traceFile' into 'cacheFile'. A timed 'set' stops the node
+	 * and moves it in 1 ns, since waypoints must be strictly ordered in
+	 * time; the 'set' commands of a node at the same time make one move.
+	 */
+	static bool Compile (std::string traceFile, std::string cacheFile);
+
+	/**
+	 * \returns the 64-bit FNV-1a hash of the contents of 'file'
+	 */
+	static uint64_t HashFile (std::string file);
+
+	struct FileHeader
+	{
+		char		magic[8];		// "INCMOB02"
+		uint64_t	traceHash;		// Hash of the source trace
+		uint64_t	traceSize;		// Size of the source trace, in bytes
+		uint32_t	nodeCount;
+		uint32_t	reserved;
+		uint64_t	recordCount;
+		// Followed by uint64_t offsets[nodeCount + 1] and Record records[recordCount]
+	};
+
+	struct Record
+	{
+		double		time;
+		double		x;
+		double		y;
+		double		z;
+		double		speed;			// Speed of the segment that ends at this waypoint
+	};
+
+private:
+	Ns2MobilityCache (const Ns2MobilityCache &);
+	Ns2MobilityCache &operator = (const Ns2MobilityCache &);
+
+	bool Map (void);
+	void Unmap (void);
+	bool IsStale (void) const;
+
+	std::string			m_traceFile;
+	std::string			m_cacheFile;
+
+	void				*m_map;
+	size_t				m_mapSize;
+	const FileHeader	*m_header;
+	const uint64_t		*m_offsets;
+	const Record		*m_records;
+};
+
+} // namespace ns3
+
+
+#endif /* NS2_MOBILITY_CACHE_H_ */
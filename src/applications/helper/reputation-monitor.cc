@@ -0,0 +1,112 @@
+/*
+ * reputation-monitor.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/callback.h"
+#include "ns3/node.h"
+
+#include "reputation-monitor.h"
+#include "reputation-trace-writer.h"
+
+NS_LOG_COMPONENT_DEFINE ("ReputationMonitor");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ReputationMonitor);
+
+TypeId
+ReputationMonitor::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::ReputationMonitor")
+			.SetParent<Object> ()
+			.AddConstructor<ReputationMonitor> ()
+	;
+
+	return tid;
+}
+
+ReputationMonitor::ReputationMonitor ()
+{
+}
+
+ReputationMonitor::~ReputationMonitor ()
+{
+}
+
+void
+ReputationMonitor::Install (NodeContainer nodes)
+{
+	NS_ASSERT_MSG (m_entries.empty (), "ReputationMonitor: already installed");
+
+	m_nodes = nodes;
+	m_entries.resize (nodes.GetN ());
+	m_values.resize (nodes.GetN ());
+
+	for ( uint32_t i = 0; i < nodes.GetN (); i++ )
+	{
+		Ptr<ReputationState> state = nodes.Get (i)->GetReputationState ();
+		m_entries[i].monitor = this;
+		m_entries[i].index = i;
+		m_values[i] = state->GetReputation ();
+		state->TraceConnectWithoutContext ("Reputation",
+				MakeBoundCallback (&ReputationMonitor::ReputationChanged, &m_entries[i]));
+	}
+}
+
+const std::vector<double> &
+ReputationMonitor::GetReputationValues (void) const
+{
+	return m_values;
+}
+
+void
+ReputationMonitor::SetTraceWriter (Ptr<ReputationTraceWriter> writer)
+{
+	m_writer = writer;
+}
+
+void
+ReputationMonitor::ReputationChanged (Entry *entry, double oldValue, double newValue)
+{
+	ReputationMonitor *monitor = entry->monitor;
+	monitor->m_values[entry->index] = newValue;
+	if ( monitor->m_writer != 0 )
+	{
+		monitor->m_writer->NotifyChange (Simulator::Now (), entry->index, newValue);
+	}
+}
+
+void
+ReputationMonitor::DoDispose (void)
+{
+	for ( uint32_t i = 0; i < m_entries.size (); i++ )
+	{
+		m_nodes.Get (i)->GetReputationState ()->TraceDisconnectWithoutContext ("Reputation",
+				MakeBoundCallback (&ReputationMonitor::ReputationChanged, &m_entries[i]));
+	}
+	m_entries.clear ();
+	m_nodes = NodeContainer ();
+	m_writer = 0;
+	Object::DoDispose ();
+}
+
+} // namespace ns3
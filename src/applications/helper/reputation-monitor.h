@@ -0,0 +1,91 @@
+/*
+ * reputation-monitor.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef REPUTATION_MONITOR_H_
+#define REPUTATION_MONITOR_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/node-container.h"
+
+namespace ns3 {
+
+class ReputationTraceWriter;
+
+/**
+ * \ingroup applications
+ *
+ * \brief Keeps the current reputation of a set of nodes.
+ *
+ * Install () connects to the "Reputation" trace of the ReputationState of
+ * every node with ConnectWithoutContext, binding the index of the node to
+ * the callback, so no trace path has to be parsed when a reputation
+ * changes.
+ */
+class ReputationMonitor : public Object
+{
+public:
+	static TypeId GetTypeId (void);
+
+	ReputationMonitor ();
+	virtual ~ReputationMonitor ();
+
+	/**
+	 * Starts following the reputation of 'nodes'. The values are indexed
+	 * like the container.
+	 */
+	void Install (NodeContainer nodes);
+
+	/**
+	 * \returns the current reputation of every monitored node
+	 */
+	const std::vector<double> &GetReputationValues (void) const;
+
+	/**
+	 * Every change is also passed to writer->NotifyChange ().
+	 */
+	void SetTraceWriter (Ptr<ReputationTraceWriter> writer);
+
+protected:
+	virtual void DoDispose (void);
+
+private:
+	struct Entry
+	{
+		ReputationMonitor	*monitor;
+		uint32_t			index;
+	};
+
+	static void ReputationChanged (Entry *entry, double oldValue, double newValue);
+
+	NodeContainer			m_nodes;
+	std::vector<Entry>		m_entries;		// Bound to the callbacks, never reallocated once connected
+	std::vector<double>		m_values;
+
+	Ptr<ReputationTraceWriter>	m_writer;
+};
+
+} // namespace ns3
+
+
+#endif /* REPUTATION_MONITOR_H_ */
@@ -0,0 +1,620 @@
+/*
+ * reputation-trace-writer.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <cstring>
+
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+
+#include "reputation-trace-writer.h"
+
+NS_LOG_COMPONENT_DEFINE ("ReputationTraceWriter");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ReputationTraceWriter);
+NS_OBJECT_ENSURE_REGISTERED (CsvReputationTraceWriter);
+NS_OBJECT_ENSURE_REGISTERED (BinaryReputationTraceWriter);
+NS_OBJECT_ENSURE_REGISTERED (ChangeLogReputationTraceWriter);
+
+static const char REPUTATION_MAGIC[8] = { 'I', 'N', 'C', 'R', 'E', 'P', '0', '1' };
+static const char CHANGE_LOG_MAGIC[8] = { 'I', 'N', 'C', 'L', 'O', 'G', '0', '1' };
+
+/*
+ * REPUTATION_TRACE_WRITER
+ */
+
+TypeId
+ReputationTraceWriter::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::ReputationTraceWriter")
+			.SetParent<Object> ()
+	;
+
+	return tid;
+}
+
+ReputationTraceWriter::ReputationTraceWriter ()
+{
+}
+
+ReputationTraceWriter::~ReputationTraceWriter ()
+{
+}
+
+void
+ReputationTraceWriter::NotifyChange (Time time, uint32_t nodeId, double value)
+{
+}
+
+void
+ReputationTraceWriter::DoDispose (void)
+{
+	Close ();
+	Object::DoDispose ();
+}
+
+/*
+ * CSV_REPUTATION_TRACE_WRITER
+ */
+
+TypeId
+CsvReputationTraceWriter::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::CsvReputationTraceWriter")
+			.SetParent<ReputationTraceWriter> ()
+			.AddConstructor<CsvReputationTraceWriter> ()
+	;
+
+	return tid;
+}
+
+CsvReputationTraceWriter::CsvReputationTraceWriter ()
+{
+}
+
+CsvReputationTraceWriter::~CsvReputationTraceWriter ()
+{
+}
+
+bool
+CsvReputationTraceWriter::Open (std::string fileName, const std::vector<uint8_t> &roles)
+{
+	m_os.open (fileName.c_str ());
+	return m_os.good ();
+}
+
+void
+CsvReputationTraceWriter::WriteFrame (Time time, uint32_t generatedIncidents, const std::vector<double> &reputation)
+{
+	m_os << generatedIncidents << ",";
+	for (unsigned int i = 0; i < reputation.size (); i++)
+	{
+		if ( i == (reputation.size () - 1) )
+			m_os << reputation[i];
+		else
+			m_os << reputation[i] << ",";
+	}
+	m_os << "\n";
+}
+
+void
+CsvReputationTraceWriter::Close (void)
+{
+	if ( m_os.is_open () ) m_os.close ();
+}
+
+/*
+ * BINARY_REPUTATION_TRACE_WRITER
+ */
+
+TypeId
+BinaryReputationTraceWriter::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::BinaryReputationTraceWriter")
+			.SetParent<ReputationTraceWriter> ()
+			.AddConstructor<BinaryReputationTraceWriter> ()
+			.AddAttribute ("Precision", "Bits per reputation value (32 or 64).",
+					UintegerValue (64),
+					MakeUintegerAccessor (&BinaryReputationTraceWriter::m_precision),
+					MakeUintegerChecker<uint32_t> (32, 64))
+			.AddAttribute ("Compression", "Frame encoding.",
+					EnumValue (BinaryReputationTraceWriter::NONE),
+					MakeEnumAccessor (&BinaryReputationTraceWriter::m_compression),
+					MakeEnumChecker (BinaryReputationTraceWriter::NONE, "None",
+							BinaryReputationTraceWriter::RLE, "Rle",
+							BinaryReputationTraceWriter::DELTA, "Delta"))
+	;
+
+	return tid;
+}
+
+BinaryReputationTraceWriter::BinaryReputationTraceWriter ()
+	: m_precision (64),
+	  m_compression (NONE),
+	  m_file (0),
+	  m_nNodes (0)
+{
+}
+
+BinaryReputationTraceWriter::~BinaryReputationTraceWriter ()
+{
+	Close ();
+}
+
+bool
+BinaryReputationTraceWriter::Open (std::string fileName, const std::vector<uint8_t> &roles)
+{
+	Close ();
+
+	if ( m_precision != 32 && m_precision != 64 )
+	{
+		NS_LOG_ERROR ("Unsupported reputation trace precision " << m_precision);
+		return false;
+	}
+
+	m_file = fopen (fileName.c_str (), "wb");
+	if ( m_file == 0 )
+	{
+		NS_LOG_ERROR ("Unable to create reputation trace " << fileName);
+		return false;
+	}
+
+	m_nNodes = roles.size ();
+	m_previous.assign (m_nNodes, 0);
+	m_words.resize (m_nNodes);
+
+	FileHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, REPUTATION_MAGIC, sizeof (header.magic));
+	header.nodeCount = m_nNodes;
+	header.valueSize = m_precision / 8;
+	header.compression = m_compression;
+
+	bool ok = fwrite (&header, sizeof (header), 1, m_file) == 1;
+	if ( m_nNodes > 0 ) ok = ok && fwrite (&roles[0], 1, m_nNodes, m_file) == m_nNodes;
+	return ok;
+}
+
+void
+BinaryReputationTraceWriter::AppendWord (uint64_t word)
+{
+	if ( m_precision == 32 )
+	{
+		uint32_t word32 = (uint32_t) word;
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *> (&word32);
+		m_payload.insert (m_payload.end (), bytes, bytes + sizeof (word32));
+	}
+	else
+	{
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *> (&word);
+		m_payload.insert (m_payload.end (), bytes, bytes + sizeof (word));
+	}
+}
+
+void
+BinaryReputationTraceWriter::WriteFrame (Time time, uint32_t generatedIncidents, const std::vector<double> &reputation)
+{
+	if ( m_file == 0 ) return;
+	NS_ASSERT_MSG (reputation.size () == m_nNodes, "BinaryReputationTraceWriter: expected " << m_nNodes << " values");
+
+	for ( uint32_t i = 0; i < m_nNodes; i++ )
+	{
+		uint64_t word = 0;
+		if ( m_precision == 32 )
+		{
+			float value = (float) reputation[i];
+			uint32_t word32;
+			memcpy (&word32, &value, sizeof (word32));
+			word = word32;
+		}
+		else
+		{
+			memcpy (&word, &reputation[i], sizeof (word));
+		}
+
+		if ( m_compression == DELTA )
+		{
+			m_words[i] = word ^ m_previous[i];
+			m_previous[i] = word;
+		}
+		else
+		{
+			m_words[i] = word;
+		}
+	}
+
+	m_payload.clear ();
+	if ( m_compression == NONE )
+	{
+		for ( uint32_t i = 0; i < m_nNodes; i++ ) AppendWord (m_words[i]);
+	}
+	else
+	{
+		uint32_t i = 0;
+		while ( i < m_nNodes )
+		{
+			uint32_t run = 1;
+			while ( i + run < m_nNodes && m_words[i + run] == m_words[i] ) run++;
+
+			const uint8_t *bytes = reinterpret_cast<const uint8_t *> (&run);
+			m_payload.insert (m_payload.end (), bytes, bytes + sizeof (run));
+			AppendWord (m_words[i]);
+			i += run;
+		}
+	}
+
+	FrameHeader frame;
+	memset (&frame, 0, sizeof (frame));
+	frame.time = time.GetSeconds ();
+	frame.generatedIncidents = generatedIncidents;
+	frame.payloadSize = m_payload.size ();
+
+	fwrite (&frame, sizeof (frame), 1, m_file);
+	if ( !m_payload.empty () ) fwrite (&m_payload[0], 1, m_payload.size (), m_file);
+}
+
+void
+BinaryReputationTraceWriter::Close (void)
+{
+	if ( m_file != 0 )
+	{
+		fclose (m_file);
+		m_file = 0;
+	}
+}
+
+/*
+ * CHANGE_LOG_REPUTATION_TRACE_WRITER
+ */
+
+TypeId
+ChangeLogReputationTraceWriter::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::ChangeLogReputationTraceWriter")
+			.SetParent<ReputationTraceWriter> ()
+			.AddConstructor<ChangeLogReputationTraceWriter> ()
+			.AddAttribute ("KeyframeInterval", "Write the reputation of all the nodes every this many frames.",
+					UintegerValue (10),
+					MakeUintegerAccessor (&ChangeLogReputationTraceWriter::m_keyframeInterval),
+					MakeUintegerChecker<uint32_t> (1))
+	;
+
+	return tid;
+}
+
+ChangeLogReputationTraceWriter::ChangeLogReputationTraceWriter ()
+	: m_keyframeInterval (10),
+	  m_file (0),
+	  m_nNodes (0),
+	  m_frames (0)
+{
+}
+
+ChangeLogReputationTraceWriter::~ChangeLogReputationTraceWriter ()
+{
+	Close ();
+}
+
+bool
+ChangeLogReputationTraceWriter::Open (std::string fileName, const std::vector<uint8_t> &roles)
+{
+	Close ();
+
+	m_file = fopen (fileName.c_str (), "wb");
+	if ( m_file == 0 )
+	{
+		NS_LOG_ERROR ("Unable to create reputation change log " << fileName);
+		return false;
+	}
+
+	m_nNodes = roles.size ();
+	m_frames = 0;
+
+	BinaryReputationTraceWriter::FileHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, CHANGE_LOG_MAGIC, sizeof (header.magic));
+	header.nodeCount = m_nNodes;
+	header.valueSize = sizeof (double);
+
+	bool ok = fwrite (&header, sizeof (header), 1, m_file) == 1;
+	if ( m_nNodes > 0 ) ok = ok && fwrite (&roles[0], 1, m_nNodes, m_file) == m_nNodes;
+	return ok;
+}
+
+void
+ChangeLogReputationTraceWriter::WriteFrame (Time time, uint32_t generatedIncidents, const std::vector<double> &reputation)
+{
+	if ( m_file == 0 ) return;
+	NS_ASSERT_MSG (reputation.size () == m_nNodes, "ChangeLogReputationTraceWriter: expected " << m_nNodes << " values");
+
+	RecordHeader record;
+	record.time = time.GetSeconds ();
+	record.type = (m_frames % m_keyframeInterval == 0) ? KEYFRAME : FRAME;
+	record.arg = generatedIncidents;
+	fwrite (&record, sizeof (record), 1, m_file);
+
+	if ( record.type == KEYFRAME && m_nNodes > 0 )
+	{
+		fwrite (&reputation[0], sizeof (double), m_nNodes, m_file);
+	}
+	m_frames++;
+}
+
+void
+ChangeLogReputationTraceWriter::NotifyChange (Time time, uint32_t nodeId, double value)
+{
+	if ( m_file == 0 ) return;
+
+	struct
+	{
+		RecordHeader	header;
+		double			value;
+	} change;
+	change.header.time = time.GetSeconds ();
+	change.header.type = CHANGE;
+	change.header.arg = nodeId;
+	change.value = value;
+	fwrite (&change, sizeof (change), 1, m_file);
+}
+
+void
+ChangeLogReputationTraceWriter::Close (void)
+{
+	if ( m_file != 0 )
+	{
+		fclose (m_file);
+		m_file = 0;
+	}
+}
+
+/*
+ * REPUTATION_TRACE_READER
+ */
+
+ReputationTraceReader::ReputationTraceReader ()
+	: m_file (0),
+	  m_changeLog (false),
+	  m_dataOffset (0)
+{
+	memset (&m_header, 0, sizeof (m_header));
+}
+
+ReputationTraceReader::~ReputationTraceReader ()
+{
+	Close ();
+}
+
+bool
+ReputationTraceReader::Open (std::string fileName)
+{
+	Close ();
+
+	m_file = fopen (fileName.c_str (), "rb");
+	if ( m_file == 0 ) return false;
+
+	bool ok = fread (&m_header, sizeof (m_header), 1, m_file) == 1;
+	m_changeLog = ok && memcmp (m_header.magic, CHANGE_LOG_MAGIC, sizeof (CHANGE_LOG_MAGIC)) == 0;
+	if ( !ok
+			|| (!m_changeLog && memcmp (m_header.magic, REPUTATION_MAGIC, sizeof (REPUTATION_MAGIC)) != 0)
+			|| (m_changeLog && m_header.valueSize != sizeof (double))
+			|| (m_header.valueSize != 4 && m_header.valueSize != 8)
+			|| m_header.compression > BinaryReputationTraceWriter::DELTA )
+	{
+		NS_LOG_ERROR ("Not a binary reputation trace: " << fileName);
+		Close ();
+		return false;
+	}
+
+	m_roles.resize (m_header.nodeCount);
+	if ( m_header.nodeCount > 0 && fread (&m_roles[0], 1, m_header.nodeCount, m_file) != m_header.nodeCount )
+	{
+		Close ();
+		return false;
+	}
+	m_previous.assign (m_header.nodeCount, 0);
+	m_current.assign (m_header.nodeCount, 0.);
+	m_dataOffset = ftell (m_file);
+
+	return true;
+}
+
+void
+ReputationTraceReader::Close (void)
+{
+	if ( m_file != 0 )
+	{
+		fclose (m_file);
+		m_file = 0;
+	}
+}
+
+uint32_t
+ReputationTraceReader::GetNNodes (void) const
+{
+	return m_header.nodeCount;
+}
+
+uint8_t
+ReputationTraceReader::GetRole (uint32_t nodeId) const
+{
+	return m_roles.at (nodeId);
+}
+
+double
+ReputationTraceReader::DecodeWord (uint64_t word) const
+{
+	if ( m_header.valueSize == 4 )
+	{
+		uint32_t word32 = (uint32_t) word;
+		float value;
+		memcpy (&value, &word32, sizeof (value));
+		return value;
+	}
+
+	double value;
+	memcpy (&value, &word, sizeof (value));
+	return value;
+}
+
+bool
+ReputationTraceReader::ReadFrame (double &time, uint32_t &generatedIncidents, std::vector<double> &reputation)
+{
+	if ( m_file == 0 ) return false;
+	if ( m_changeLog ) return ReadChangeLogFrame (time, generatedIncidents, reputation);
+
+	BinaryReputationTraceWriter::FrameHeader frame;
+	if ( fread (&frame, sizeof (frame), 1, m_file) != 1 ) return false;
+
+	m_payload.resize (frame.payloadSize);
+	if ( frame.payloadSize > 0 && fread (&m_payload[0], 1, frame.payloadSize, m_file) != frame.payloadSize ) return false;
+
+	time = frame.time;
+	generatedIncidents = frame.generatedIncidents;
+	reputation.resize (m_header.nodeCount);
+
+	const uint8_t *p = m_payload.empty () ? 0 : &m_payload[0];
+	const uint8_t *end = p + m_payload.size ();
+	uint32_t valueSize = m_header.valueSize;
+	uint32_t node = 0;
+	while ( node < m_header.nodeCount )
+	{
+		uint32_t run = 1;
+		if ( m_header.compression != BinaryReputationTraceWriter::NONE )
+		{
+			if ( p + sizeof (run) > end ) return false;
+			memcpy (&run, p, sizeof (run));
+			p += sizeof (run);
+		}
+		if ( p + valueSize > end || run == 0 || node + run > m_header.nodeCount ) return false;
+
+		uint64_t word = 0;
+		if ( valueSize == 4 )
+		{
+			uint32_t word32;
+			memcpy (&word32, p, sizeof (word32));
+			word = word32;
+		}
+		else
+		{
+			memcpy (&word, p, sizeof (word));
+		}
+		p += valueSize;
+
+		for ( uint32_t i = 0; i < run; i++, node++ )
+		{
+			uint64_t bits = word;
+			if ( m_header.compression == BinaryReputationTraceWriter::DELTA )
+			{
+				bits ^= m_previous[node];
+				m_previous[node] = bits;
+			}
+			reputation[node] = DecodeWord (bits);
+		}
+	}
+
+	return true;
+}
+
+bool
+ReputationTraceReader::ReadChangeLogFrame (double &time, uint32_t &generatedIncidents, std::vector<double> &reputation)
+{
+	ChangeLogReputationTraceWriter::RecordHeader record;
+	while ( fread (&record, sizeof (record), 1, m_file) == 1 )
+	{
+		if ( record.type == ChangeLogReputationTraceWriter::CHANGE )
+		{
+			double value;
+			if ( fread (&value, sizeof (value), 1, m_file) != 1 ) return false;
+			if ( record.arg < m_current.size () ) m_current[record.arg] = value;
+			continue;
+		}
+
+		if ( record.type == ChangeLogReputationTraceWriter::KEYFRAME && m_header.nodeCount > 0 )
+		{
+			if ( fread (&m_current[0], sizeof (double), m_header.nodeCount, m_file) != m_header.nodeCount ) return false;
+		}
+		else if ( record.type != ChangeLogReputationTraceWriter::FRAME )
+		{
+			NS_LOG_ERROR ("Corrupted reputation change log");
+			return false;
+		}
+
+		time = record.time;
+		generatedIncidents = record.arg;
+		reputation = m_current;
+		return true;
+	}
+
+	return false;
+}
+
+bool
+ReputationTraceReader::Seek (double time)
+{
+	if ( m_file == 0 ) return false;
+	if ( !m_changeLog && m_header.compression == BinaryReputationTraceWriter::DELTA ) return false;
+
+	// Only the headers are read; payloads are skipped
+	long target = -1;
+	fseek (m_file, m_dataOffset, SEEK_SET);
+	while ( true )
+	{
+		long offset = ftell (m_file);
+		double frameTime;
+		long skip;
+		bool seekable;
+
+		if ( m_changeLog )
+		{
+			ChangeLogReputationTraceWriter::RecordHeader record;
+			if ( fread (&record, sizeof (record), 1, m_file) != 1 ) break;
+			frameTime = record.time;
+			seekable = record.type == ChangeLogReputationTraceWriter::KEYFRAME;
+			skip = record.type == ChangeLogReputationTraceWriter::CHANGE ? sizeof (double)
+					: seekable ? (long) m_header.nodeCount * sizeof (double) : 0;
+		}
+		else
+		{
+			BinaryReputationTraceWriter::FrameHeader frame;
+			if ( fread (&frame, sizeof (frame), 1, m_file) != 1 ) break;
+			frameTime = frame.time;
+			seekable = true;
+			skip = frame.payloadSize;
+		}
+
+		if ( seekable && frameTime > time ) break;
+		if ( seekable ) target = offset;
+		if ( fseek (m_file, skip, SEEK_CUR) != 0 ) break;
+	}
+
+	if ( target < 0 )
+	{
+		fseek (m_file, m_dataOffset, SEEK_SET);
+		return false;
+	}
+
+	fseek (m_file, target, SEEK_SET);
+	return true;
+}
+
+} // namespace ns3
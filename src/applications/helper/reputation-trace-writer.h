@@ -0,0 +1,282 @@
+/*
+ * reputation-trace-writer.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef REPUTATION_TRACE_WRITER_H_
+#define REPUTATION_TRACE_WRITER_H_
+
+#include <stdint.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Destination of the periodic reputation dumps of a simulation.
+ *
+ * Every frame holds the reputation of all the nodes at a given time, plus
+ * the number of incidents generated so far. The backend is chosen by
+ * TypeId (see CsvReputationTraceWriter, BinaryReputationTraceWriter and
+ * ChangeLogReputationTraceWriter).
+ */
+class ReputationTraceWriter : public Object
+{
+public:
+	enum NodeRole
+	{
+		SELFISH_NODE = 0,
+		ALTRUISTIC_NODE = 1,
+		MALICIOUS_NODE = 2,
+		RANDOM_NODE = 3
+	};
+
+	static TypeId GetTypeId (void);
+
+	ReputationTraceWriter ();
+	virtual ~ReputationTraceWriter ();
+
+	/**
+	 * Creates 'fileName' for a trace of roles.size () nodes, roles[i]
+	 * being the NodeRole of node i.
+	 */
+	virtual bool Open (std::string fileName, const std::vector<uint8_t> &roles) = 0;
+
+	/**
+	 * Appends the reputation of every node at 'time'.
+	 */
+	virtual void WriteFrame (Time time, uint32_t generatedIncidents, const std::vector<double> &reputation) = 0;
+
+	/**
+	 * The reputation of node 'nodeId' has just changed to 'value'. Backends
+	 * that only write whole frames ignore it.
+	 */
+	virtual void NotifyChange (Time time, uint32_t nodeId, double value);
+
+	virtual void Close (void) = 0;
+
+protected:
+	virtual void DoDispose (void);
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief The historical text trace: one 'generatedIncidents,rep0,rep1,...'
+ * row per frame.
+ */
+class CsvReputationTraceWriter : public ReputationTraceWriter
+{
+public:
+	static TypeId GetTypeId (void);
+
+	CsvReputationTraceWriter ();
+	virtual ~CsvReputationTraceWriter ();
+
+	virtual bool Open (std::string fileName, const std::vector<uint8_t> &roles);
+	virtual void WriteFrame (Time time, uint32_t generatedIncidents, const std::vector<double> &reputation);
+	virtual void Close (void);
+
+private:
+	std::ofstream	m_os;
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief Binary, fixed-width reputation trace.
+ *
+ * The file starts with a header (magic "INCREP01", node count, value width
+ * and compression) followed by the role of every node. Each frame is its
+ * time, the number of generated incidents and the size of its payload, so
+ * readers can skip it; the payload holds one float32/float64 per node:
+ *
+ *  - NONE:  the values, in node order.
+ *  - RLE:   (uint32 run, value) pairs of consecutive equal values.
+ *  - DELTA: like RLE, but every value is XORed with the bits it had in the
+ *           previous frame, so nodes that did not change form runs of 0.
+ *
+ * All the encodings are lossless (float32 apart). ReputationTraceReader
+ * decodes the file.
+ */
+class BinaryReputationTraceWriter : public ReputationTraceWriter
+{
+public:
+	enum Compression
+	{
+		NONE,
+		RLE,
+		DELTA
+	};
+
+	static TypeId GetTypeId (void);
+
+	BinaryReputationTraceWriter ();
+	virtual ~BinaryReputationTraceWriter ();
+
+	virtual bool Open (std::string fileName, const std::vector<uint8_t> &roles);
+	virtual void WriteFrame (Time time, uint32_t generatedIncidents, const std::vector<double> &reputation);
+	virtual void Close (void);
+
+	struct FileHeader
+	{
+		char		magic[8];		// "INCREP01"
+		uint32_t	nodeCount;
+		uint8_t		valueSize;		// 4 or 8 bytes
+		uint8_t		compression;
+		uint16_t	reserved;
+	};
+
+	struct FrameHeader
+	{
+		double		time;			// Seconds
+		uint32_t	generatedIncidents;
+		uint32_t	payloadSize;	// Bytes following this header
+	};
+
+private:
+	void AppendWord (uint64_t word);
+
+	uint32_t	m_precision;		// 32 or 64 bits per value
+	Compression	m_compression;
+
+	FILE					*m_file;
+	uint32_t				m_nNodes;
+	std::vector<uint64_t>	m_previous;		// Bits of the last frame (DELTA)
+	std::vector<uint64_t>	m_words;
+	std::vector<uint8_t>	m_payload;
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief Append-only log of the reputation changes.
+ *
+ * Instead of every node at every frame, the log holds one record per
+ * reputation change, so its size follows the activity of the simulation.
+ * Frames only write a small marker with their time and number of generated
+ * incidents, except every 'KeyframeInterval' frames, where the reputation
+ * of all the nodes is written so readers can start from there.
+ *
+ * The file has the header of BinaryReputationTraceWriter (magic "INCLOG01",
+ * 64-bit values) and the node roles, followed by records that start with a
+ * RecordHeader:
+ *
+ *  - CHANGE:   'arg' is the node id, followed by its new value.
+ *  - FRAME:    'arg' is the number of generated incidents.
+ *  - KEYFRAME: like FRAME, followed by the value of every node.
+ */
+class ChangeLogReputationTraceWriter : public ReputationTraceWriter
+{
+public:
+	enum RecordType
+	{
+		CHANGE = 0,
+		FRAME = 1,
+		KEYFRAME = 2
+	};
+
+	struct RecordHeader
+	{
+		double		time;		// Seconds
+		uint32_t	type;		// RecordType
+		uint32_t	arg;
+	};
+
+	static TypeId GetTypeId (void);
+
+	ChangeLogReputationTraceWriter ();
+	virtual ~ChangeLogReputationTraceWriter ();
+
+	virtual bool Open (std::string fileName, const std::vector<uint8_t> &roles);
+	virtual void WriteFrame (Time time, uint32_t generatedIncidents, const std::vector<double> &reputation);
+	virtual void NotifyChange (Time time, uint32_t nodeId, double value);
+	virtual void Close (void);
+
+private:
+	uint32_t	m_keyframeInterval;
+
+	FILE		*m_file;
+	uint32_t	m_nNodes;
+	uint32_t	m_frames;			// Frames written so far
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief Reads back the frames of a BinaryReputationTraceWriter or a
+ * ChangeLogReputationTraceWriter file.
+ *
+ * Change logs are replayed, so every frame of the original simulation is
+ * returned in full.
+ */
+class ReputationTraceReader
+{
+public:
+	ReputationTraceReader ();
+	~ReputationTraceReader ();
+
+	bool Open (std::string fileName);
+	void Close (void);
+
+	uint32_t GetNNodes (void) const;
+	uint8_t GetRole (uint32_t nodeId) const;
+
+	/**
+	 * \returns false at the end of the trace or if the frame is truncated
+	 */
+	bool ReadFrame (double &time, uint32_t &generatedIncidents, std::vector<double> &reputation);
+
+	/**
+	 * Moves to the last keyframe (any frame of a NONE or RLE binary trace)
+	 * at or before 'time', so the next ReadFrame starts there. Delta-encoded
+	 * binary traces cannot seek.
+	 *
+	 * \returns false if there is no such frame
+	 */
+	bool Seek (double time);
+
+private:
+	ReputationTraceReader (const ReputationTraceReader &);
+	ReputationTraceReader &operator = (const ReputationTraceReader &);
+
+	double DecodeWord (uint64_t word) const;
+	bool ReadChangeLogFrame (double &time, uint32_t &generatedIncidents, std::vector<double> &reputation);
+
+	FILE					*m_file;
+	BinaryReputationTraceWriter::FileHeader	m_header;
+	bool					m_changeLog;
+	long					m_dataOffset;		// First frame or record
+	std::vector<uint8_t>	m_roles;
+	std::vector<double>		m_current;			// Replayed values (change logs)
+	std::vector<uint64_t>	m_previous;
+	std::vector<uint8_t>	m_payload;
+};
+
+} // namespace ns3
+
+
+#endif /* REPUTATION_TRACE_WRITER_H_ */
@@ -0,0 +1,296 @@
+/*
+ * resource-monitor.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/incident-generator-application.h"
+#include "ns3/incident-sink-application.h"
+#include "ns3/incidencies-registry.h"
+#include "ns3/incident-event-log.h"
+
+#include "resource-monitor.h"
+
+NS_LOG_COMPONENT_DEFINE ("ResourceMonitor");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (ResourceMonitor);
+
+static const uint32_t DUMP_APPLICATIONS = 5;	// Busiest generators and sinks in a dump
+static const uint32_t DUMP_EVENTS = 32;			// Last IncidentEventLog records in a dump
+
+static const char *SAMPLE_HEADER = "#time,wallTime,residentKiB,events,eventRate,"
+		"pendingIncidents,incidentRecords,pendingConfirmations,loggedEvents\n";
+
+static double
+WallTime (void)
+{
+	struct timeval tv;
+	gettimeofday (&tv, 0);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static void
+WriteSample (FILE *f, const ResourceMonitor::Sample &s)
+{
+	fprintf (f, "%g,%.3f,%llu,%llu,%.0f,%u,%u,%u,%llu\n", s.time, s.wallTime,
+			(unsigned long long) s.residentSize, (unsigned long long) s.events, s.eventRate,
+			s.pendingIncidents, s.incidentRecords,
+			s.pendingConfirmations, (unsigned long long) s.loggedEvents);
+}
+
+TypeId
+ResourceMonitor::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::ResourceMonitor")
+			.SetParent<Object> ()
+			.AddConstructor<ResourceMonitor> ()
+			.AddAttribute ("Interval", "Simulated time between samples.",
+					TimeValue (Seconds (10.)),
+					MakeTimeAccessor (&ResourceMonitor::m_interval),
+					MakeTimeChecker ())
+			.AddAttribute ("MaxResidentSize", "Resident size, in MiB, above which the simulation is stopped "
+					"(0 for no limit).",
+					UintegerValue (0),
+					MakeUintegerAccessor (&ResourceMonitor::m_maxResidentSize),
+					MakeUintegerChecker<uint64_t> ())
+			.AddAttribute ("MaxPendingIncidents", "Incidents waiting for confirmations, in all the generators, "
+					"above which the simulation is stopped (0 for no limit).",
+					UintegerValue (0),
+					MakeUintegerAccessor (&ResourceMonitor::m_maxPendingIncidents),
+					MakeUintegerChecker<uint32_t> ())
+			.AddAttribute ("MaxEventRate", "Events scheduled per wall clock second above which the "
+					"simulation is stopped (0 for no limit).",
+					DoubleValue (0.),
+					MakeDoubleAccessor (&ResourceMonitor::m_maxEventRate),
+					MakeDoubleChecker<double> (0.))
+			.AddAttribute ("History", "Samples printed when a limit is exceeded.",
+					UintegerValue (16),
+					MakeUintegerAccessor (&ResourceMonitor::m_history),
+					MakeUintegerChecker<uint32_t> (1))
+	;
+
+	return tid;
+}
+
+ResourceMonitor::ResourceMonitor ()
+	: m_file (0),
+	  m_wallStart (0.),
+	  m_limitExceeded (false)
+{
+}
+
+ResourceMonitor::~ResourceMonitor ()
+{
+}
+
+bool
+ResourceMonitor::Open (std::string file)
+{
+	NS_LOG_FUNCTION (this << file);
+	NS_ASSERT_MSG (!m_sampleEvent.IsRunning (), "ResourceMonitor: already open");
+
+	if ( !file.empty () )
+	{
+		m_file = fopen (file.c_str (), "w");
+		if ( m_file == 0 ) return false;
+		fputs (SAMPLE_HEADER, m_file);
+	}
+
+	m_wallStart = WallTime ();
+	m_samples.clear ();
+	m_limitExceeded = false;
+	m_sampleEvent = Simulator::ScheduleNow (&ResourceMonitor::TakeSample, this);
+	return true;
+}
+
+void
+ResourceMonitor::Close (void)
+{
+	NS_LOG_FUNCTION (this);
+
+	Simulator::Cancel (m_sampleEvent);
+	if ( m_file != 0 )
+	{
+		fclose (m_file);
+		m_file = 0;
+	}
+}
+
+bool
+ResourceMonitor::GetLimitExceeded (void) const
+{
+	return m_limitExceeded;
+}
+
+uint64_t
+ResourceMonitor::GetResidentSize (void)
+{
+	FILE *f = fopen ("/proc/self/statm", "r");
+	if ( f == 0 ) return 0;
+
+	unsigned long size = 0, resident = 0;
+	if ( fscanf (f, "%lu %lu", &size, &resident) != 2 ) resident = 0;
+	fclose (f);
+	return (uint64_t) resident * sysconf (_SC_PAGESIZE) / 1024;
+}
+
+void
+ResourceMonitor::TakeSample (void)
+{
+	// Scheduled first, so that its uid counts every event scheduled so far
+	m_sampleEvent = Simulator::Schedule (m_interval, &ResourceMonitor::TakeSample, this);
+
+	Sample sample;
+	sample.time = Simulator::Now ().GetSeconds ();
+	sample.wallTime = WallTime () - m_wallStart;
+	sample.residentSize = GetResidentSize ();
+	sample.events = m_sampleEvent.GetUid ();
+	sample.loggedEvents = IncidentEventLog::GetNRecorded ();
+
+	sample.eventRate = 0.;
+	if ( !m_samples.empty () && sample.wallTime > m_samples.back ().wallTime )
+	{
+		sample.eventRate = (sample.events - m_samples.back ().events) / (sample.wallTime - m_samples.back ().wallTime);
+	}
+
+	sample.pendingIncidents = 0;
+	sample.incidentRecords = 0;
+	sample.pendingConfirmations = 0;
+	for ( uint32_t i = 0; i < IncidenciesRegistry::GetN (); i++ )
+	{
+		Ptr<IncidentGenerator> generator = IncidenciesRegistry::GetGenerator (i);
+		if ( generator != 0 )
+		{
+			sample.pendingIncidents += generator->GetNPendingIncidents ();
+			sample.incidentRecords += generator->GetNIncidentRecords ();
+		}
+
+		Ptr<IncidentSink> sink = IncidenciesRegistry::GetSink (i);
+		if ( sink != 0 ) sample.pendingConfirmations += sink->GetNPendingConfirmations ();
+	}
+
+	if ( m_samples.size () >= m_history ) m_samples.erase (m_samples.begin ());
+	m_samples.push_back (sample);
+
+	if ( m_file != 0 )
+	{
+		// Flushed at once, the process may not survive to the next sample
+		WriteSample (m_file, sample);
+		fflush (m_file);
+	}
+
+	std::stringstream reason;
+	if ( m_maxResidentSize != 0 && sample.residentSize > m_maxResidentSize * 1024 )
+	{
+		reason << "resident size " << sample.residentSize / 1024 << " MiB above " << m_maxResidentSize << " MiB";
+	}
+	else if ( m_maxPendingIncidents != 0 && sample.pendingIncidents > m_maxPendingIncidents )
+	{
+		reason << sample.pendingIncidents << " pending incidents, above " << m_maxPendingIncidents;
+	}
+	else if ( m_maxEventRate != 0. && sample.eventRate > m_maxEventRate )
+	{
+		reason << sample.eventRate << " events/s, above " << m_maxEventRate;
+	}
+
+	if ( !reason.str ().empty () )
+	{
+		m_limitExceeded = true;
+		Dump (reason.str ());
+		Simulator::Cancel (m_sampleEvent);
+		Simulator::Stop ();
+	}
+}
+
+void
+ResourceMonitor::Dump (const std::string &reason) const
+{
+	std::cerr << "ResourceMonitor: " << reason << " at " << Simulator::Now ().GetSeconds ()
+			<< "s, stopping the simulation" << std::endl;
+
+	std::cerr << "Last samples:" << std::endl;
+	fputs (SAMPLE_HEADER, stderr);
+	for ( uint32_t i = 0; i < m_samples.size (); i++ ) WriteSample (stderr, m_samples[i]);
+	fflush (stderr);
+
+	// (count, node id) of the busiest applications
+	std::vector<std::pair<uint32_t, uint32_t> > generators;
+	std::vector<std::pair<uint32_t, uint32_t> > sinks;
+	for ( uint32_t i = 0; i < IncidenciesRegistry::GetN (); i++ )
+	{
+		Ptr<IncidentGenerator> generator = IncidenciesRegistry::GetGenerator (i);
+		if ( generator != 0 ) generators.push_back (std::make_pair (generator->GetNPendingIncidents (), i));
+
+		Ptr<IncidentSink> sink = IncidenciesRegistry::GetSink (i);
+		if ( sink != 0 ) sinks.push_back (std::make_pair (sink->GetNPendingConfirmations (), i));
+	}
+	uint32_t nGenerators = std::min<uint32_t> (DUMP_APPLICATIONS, generators.size ());
+	uint32_t nSinks = std::min<uint32_t> (DUMP_APPLICATIONS, sinks.size ());
+	std::partial_sort (generators.begin (), generators.begin () + nGenerators, generators.end (),
+			std::greater<std::pair<uint32_t, uint32_t> > ());
+	std::partial_sort (sinks.begin (), sinks.begin () + nSinks, sinks.end (),
+			std::greater<std::pair<uint32_t, uint32_t> > ());
+
+	std::cerr << "Most pending incidents:";
+	for ( uint32_t i = 0; i < nGenerators; i++ )
+	{
+		std::cerr << " node " << generators[i].second << " (" << generators[i].first << ")";
+	}
+	std::cerr << std::endl << "Most pending confirmations:";
+	for ( uint32_t i = 0; i < nSinks; i++ )
+	{
+		std::cerr << " node " << sinks[i].second << " (" << sinks[i].first << ")";
+	}
+	std::cerr << std::endl;
+
+	std::vector<IncidentEvent> events;
+	IncidentEventLog::GetRecent (events);
+	if ( events.empty () )
+	{
+		std::cerr << "No recent events (see IncidentEventLog::SetMask)" << std::endl;
+		return;
+	}
+	std::cerr << "Last events:" << std::endl;
+	for ( size_t i = events.size () > DUMP_EVENTS ? events.size () - DUMP_EVENTS : 0; i < events.size (); i++ )
+	{
+		IncidentEventLog::Print (std::cerr, events[i]);
+	}
+}
+
+void
+ResourceMonitor::DoDispose (void)
+{
+	Close ();
+	m_samples.clear ();
+	Object::DoDispose ();
+}
+
+} // namespace ns3
@@ -0,0 +1,128 @@
+/*
+ * resource-monitor.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef RESOURCE_MONITOR_H_
+#define RESOURCE_MONITOR_H_
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Samples the resources a simulation uses, and stops it when they
+ * exceed their limits.
+ *
+ * Every 'Interval' of simulated time the monitor writes a CSV row with the
+ * resident size of the process, the events scheduled so far and per wall
+ * clock second, and the incidents waiting in the IncidentGenerator
+ * applications and the confirmations waiting in the IncidentSink
+ * applications (found through IncidenciesRegistry).
+ *
+ * ns-3.16 does not tell how many events are pending, so the event count
+ * is the uid of the next sampling event: every event scheduled since the
+ * start, executed or not. A simulation that schedules ahead of itself shows
+ * up as a rate well above the rate of the steady state. Packets are not
+ * counted: the only count ns-3.16 offers is the uid of a new packet, and
+ * creating one would shift the uids of the packets of the run.
+ *
+ * When a sample exceeds 'MaxResidentSize', 'MaxPendingIncidents' or
+ * 'MaxEventRate' the monitor prints the last samples, the busiest
+ * applications and the last events of IncidentEventLog to standard error,
+ * and stops the simulator. GetLimitExceeded then tells the driver to fail.
+ */
+class ResourceMonitor : public Object
+{
+public:
+	/**
+	 * One row of the time series.
+	 */
+	struct Sample
+	{
+		double		time;					// Simulated, in seconds
+		double		wallTime;				// Since Open, in seconds
+		uint64_t	residentSize;			// KiB
+		uint64_t	events;					// Scheduled since the start
+		double		eventRate;				// Scheduled per wall clock second since the last sample
+		uint32_t	pendingIncidents;		// In all the generators
+		uint32_t	incidentRecords;		// Allocated by all the generators
+		uint32_t	pendingConfirmations;	// In all the sinks
+		uint64_t	loggedEvents;			// IncidentEventLog records
+	};
+
+	static TypeId GetTypeId (void);
+
+	ResourceMonitor ();
+	virtual ~ResourceMonitor ();
+
+	/**
+	 * Starts sampling now. The samples are written to 'file' unless it is
+	 * empty; the limits apply either way.
+	 *
+	 * \returns false if 'file' cannot be created
+	 */
+	bool Open (std::string file);
+
+	void Close (void);
+
+	/**
+	 * \returns true if the simulation was stopped by a limit
+	 */
+	bool GetLimitExceeded (void) const;
+
+	/**
+	 * \returns the resident size of this process, in KiB, or 0 if unknown
+	 */
+	static uint64_t GetResidentSize (void);
+
+protected:
+	virtual void DoDispose (void);
+
+private:
+	void TakeSample (void);
+	void Dump (const std::string &reason) const;
+
+	Time		m_interval;
+	uint64_t	m_maxResidentSize;		// MiB, 0 for no limit
+	uint32_t	m_maxPendingIncidents;	// 0 for no limit
+	double		m_maxEventRate;			// 0 for no limit
+	uint32_t	m_history;				// Samples kept for the dump
+
+	FILE		*m_file;
+	EventId		m_sampleEvent;
+	double		m_wallStart;
+	bool		m_limitExceeded;
+
+	std::vector<Sample>	m_samples;		// The last m_history samples, oldest first
+};
+
+} // namespace ns3
+
+
+#endif /* RESOURCE_MONITOR_H_ */
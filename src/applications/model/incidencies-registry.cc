@@ -0,0 +1,109 @@
+/*
+ * incidencies-registry.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <vector>
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include "incidencies-registry.h"
+#include "incident-generator-application.h"
+#include "incident-sink-application.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("IncidenciesRegistry");
+
+static std::vector<Ptr<IncidentGenerator> > g_generators;	// Indexed by node id
+static std::vector<Ptr<IncidentSink> > g_sinks;
+static bool g_clearScheduled = false;
+
+static void
+Reserve (uint32_t nodeId, void (*clear) (void))
+{
+	if ( !g_clearScheduled )
+	{
+		Simulator::ScheduleDestroy (clear);
+		g_clearScheduled = true;
+	}
+
+	if ( nodeId >= g_generators.size () )
+	{
+		g_generators.resize (nodeId + 1);
+		g_sinks.resize (nodeId + 1);
+	}
+}
+
+void
+IncidenciesRegistry::Add (uint32_t nodeId, Ptr<IncidentGenerator> generator)
+{
+	NS_LOG_FUNCTION (nodeId << generator);
+
+	Reserve (nodeId, &IncidenciesRegistry::Clear);
+
+	NS_ASSERT_MSG (g_generators[nodeId] == 0 || g_generators[nodeId] == generator,
+			"IncidenciesRegistry: Node " << nodeId << " already has an IncidentGenerator");
+	g_generators[nodeId] = generator;
+}
+
+Ptr<IncidentGenerator>
+IncidenciesRegistry::GetGenerator (uint32_t nodeId)
+{
+	if ( nodeId >= g_generators.size () ) return 0;
+	return g_generators[nodeId];
+}
+
+void
+IncidenciesRegistry::AddSink (uint32_t nodeId, Ptr<IncidentSink> sink)
+{
+	NS_LOG_FUNCTION (nodeId << sink);
+
+	Reserve (nodeId, &IncidenciesRegistry::Clear);
+
+	NS_ASSERT_MSG (g_sinks[nodeId] == 0 || g_sinks[nodeId] == sink,
+			"IncidenciesRegistry: Node " << nodeId << " already has an IncidentSink");
+	g_sinks[nodeId] = sink;
+}
+
+Ptr<IncidentSink>
+IncidenciesRegistry::GetSink (uint32_t nodeId)
+{
+	if ( nodeId >= g_sinks.size () ) return 0;
+	return g_sinks[nodeId];
+}
+
+uint32_t
+IncidenciesRegistry::GetN (void)
+{
+	return g_generators.size ();
+}
+
+void
+IncidenciesRegistry::Clear (void)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+
+	g_generators.clear ();
+	g_sinks.clear ();
+	g_clearScheduled = false;
+}
+
+} // namespace ns3
@@ -0,0 +1,81 @@
+/*
+ * incidencies-registry.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef INCIDENCIES_REGISTRY_H_
+#define INCIDENCIES_REGISTRY_H_
+
+#include <stdint.h>
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+class IncidentGenerator;
+class IncidentSink;
+
+/**
+ * \ingroup applications
+ *
+ * \brief Dense index of the IncidentGenerator and IncidentSink installed on
+ * every node.
+ *
+ * IncidentGeneratorHelper and IncidentSinkHelper register every application
+ * they install, so incidents and messages can be dispatched to a node id
+ * without looking through its applications. Like NodeList, the registry is
+ * global and is emptied when the simulator is destroyed.
+ */
+class IncidenciesRegistry
+{
+public:
+	/**
+	 * \param nodeId id of the Node 'generator' is installed on
+	 * \param generator the generator to dispatch the incidents of 'nodeId' to
+	 */
+	static void Add (uint32_t nodeId, Ptr<IncidentGenerator> generator);
+
+	/**
+	 * \returns the generator of Node 'nodeId', or 0 if it has none
+	 */
+	static Ptr<IncidentGenerator> GetGenerator (uint32_t nodeId);
+
+	/**
+	 * \param nodeId id of the Node 'sink' is installed on
+	 * \param sink the sink to deliver the messages for 'nodeId' to
+	 */
+	static void AddSink (uint32_t nodeId, Ptr<IncidentSink> sink);
+
+	/**
+	 * \returns the sink of Node 'nodeId', or 0 if it has none
+	 */
+	static Ptr<IncidentSink> GetSink (uint32_t nodeId);
+
+	/**
+	 * \returns one past the highest registered node id
+	 */
+	static uint32_t GetN (void);
+
+private:
+	static void Clear (void);
+};
+
+} // namespace ns3
+
+
+#endif /* INCIDENCIES_REGISTRY_H_ */
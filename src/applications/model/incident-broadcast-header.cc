@@ -0,0 +1,92 @@
+/*
+ * incident-broadcast-header.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include "ns3/log.h"
+
+#include "incident-broadcast-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("IncidentBroadcastHeader");
+NS_OBJECT_ENSURE_REGISTERED (IncidentBroadcastHeader);
+
+IncidentBroadcastHeader::IncidentBroadcastHeader ()
+	: m_incidentId (0)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+IncidentBroadcastHeader::SetIncidentId (uint32_t incidentId)
+{
+	m_incidentId = incidentId;
+}
+
+uint32_t
+IncidentBroadcastHeader::GetIncidentId (void) const
+{
+	return m_incidentId;
+}
+
+TypeId
+IncidentBroadcastHeader::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::IncidentBroadcastHeader")
+			.SetParent<Header> ()
+			.AddConstructor<IncidentBroadcastHeader> ()
+	;
+	return tid;
+}
+
+TypeId
+IncidentBroadcastHeader::GetInstanceTypeId (void) const
+{
+	return GetTypeId ();
+}
+
+void
+IncidentBroadcastHeader::Print (std::ostream &os) const
+{
+	os << "(id=" << m_incidentId << ")";
+}
+
+uint32_t
+IncidentBroadcastHeader::GetSerializedSize (void) const
+{
+	return 4;
+}
+
+void
+IncidentBroadcastHeader::Serialize (Buffer::Iterator start) const
+{
+	Buffer::Iterator i = start;
+	i.WriteHtonU32 (m_incidentId);
+}
+
+uint32_t
+IncidentBroadcastHeader::Deserialize (Buffer::Iterator start)
+{
+	Buffer::Iterator i = start;
+	m_incidentId = i.ReadNtohU32 ();
+	return GetSerializedSize ();
+}
+
+} // namespace ns3
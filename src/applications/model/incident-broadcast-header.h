@@ -0,0 +1,60 @@
+/*
+ * incident-broadcast-header.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef INCIDENT_BROADCAST_HEADER_H_
+#define INCIDENT_BROADCAST_HEADER_H_
+
+#include "ns3/header.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Broadcast by an IncidentGenerator to announce a new incident.
+ *
+ * Carries the id the generator gave to the incident, which the sinks echo
+ * in their confirmations so that a generator can have several incidents
+ * waiting for confirmations at once.
+ */
+class IncidentBroadcastHeader : public Header
+{
+public:
+	IncidentBroadcastHeader ();
+
+	void SetIncidentId (uint32_t incidentId);
+	uint32_t GetIncidentId (void) const;
+
+	static TypeId GetTypeId (void);
+	virtual TypeId GetInstanceTypeId (void) const;
+	virtual void Print (std::ostream &os) const;
+	virtual uint32_t GetSerializedSize (void) const;
+	virtual void Serialize (Buffer::Iterator start) const;
+	virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+	uint32_t	m_incidentId;
+};
+
+} // namespace ns3
+
+
+#endif /* INCIDENT_BROADCAST_HEADER_H_ */
@@ -0,0 +1,140 @@
+/*
+ * incident-confirmation-header.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <string.h>
+
+#include "ns3/log.h"
+
+#include "incident-confirmation-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("IncidentConfirmationHeader");
+NS_OBJECT_ENSURE_REGISTERED (IncidentConfirmationHeader);
+
+static uint64_t
+DoubleToBits (double value)
+{
+	uint64_t bits;
+	memcpy (&bits, &value, sizeof (bits));
+	return bits;
+}
+
+static double
+BitsToDouble (uint64_t bits)
+{
+	double value;
+	memcpy (&value, &bits, sizeof (value));
+	return value;
+}
+
+IncidentConfirmationHeader::IncidentConfirmationHeader ()
+	: m_reputation (.0),
+	  m_selfishness (.0),
+	  m_incidentId (0)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+IncidentConfirmationHeader::SetReputation (double reputation)
+{
+	m_reputation = reputation;
+}
+
+double
+IncidentConfirmationHeader::GetReputation (void) const
+{
+	return m_reputation;
+}
+
+void
+IncidentConfirmationHeader::SetSelfishness (double selfishness)
+{
+	m_selfishness = selfishness;
+}
+
+double
+IncidentConfirmationHeader::GetSelfishness (void) const
+{
+	return m_selfishness;
+}
+
+void
+IncidentConfirmationHeader::SetIncidentId (uint32_t incidentId)
+{
+	m_incidentId = incidentId;
+}
+
+uint32_t
+IncidentConfirmationHeader::GetIncidentId (void) const
+{
+	return m_incidentId;
+}
+
+TypeId
+IncidentConfirmationHeader::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::IncidentConfirmationHeader")
+			.SetParent<Header> ()
+			.AddConstructor<IncidentConfirmationHeader> ()
+	;
+	return tid;
+}
+
+TypeId
+IncidentConfirmationHeader::GetInstanceTypeId (void) const
+{
+	return GetTypeId ();
+}
+
+void
+IncidentConfirmationHeader::Print (std::ostream &os) const
+{
+	os << "(r=" << m_reputation << " s=" << m_selfishness << " id=" << m_incidentId << ")";
+}
+
+uint32_t
+IncidentConfirmationHeader::GetSerializedSize (void) const
+{
+	return 8 + 8 + 4;
+}
+
+void
+IncidentConfirmationHeader::Serialize (Buffer::Iterator start) const
+{
+	Buffer::Iterator i = start;
+	i.WriteHtonU64 (DoubleToBits (m_reputation));
+	i.WriteHtonU64 (DoubleToBits (m_selfishness));
+	i.WriteHtonU32 (m_incidentId);
+}
+
+uint32_t
+IncidentConfirmationHeader::Deserialize (Buffer::Iterator start)
+{
+	Buffer::Iterator i = start;
+	m_reputation = BitsToDouble (i.ReadNtohU64 ());
+	m_selfishness = BitsToDouble (i.ReadNtohU64 ());
+	m_incidentId = i.ReadNtohU32 ();
+	return GetSerializedSize ();
+}
+
+} // namespace ns3
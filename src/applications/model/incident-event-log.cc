@@ -0,0 +1,322 @@
+/*
+ * incident-event-log.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/ipv4-address.h"
+
+#include "incident-event-log.h"
+#include "incident-validator.h"
+
+NS_LOG_COMPONENT_DEFINE ("IncidentEventLog");
+
+namespace ns3 {
+
+static const char EVENT_LOG_MAGIC[8] = { 'I', 'N', 'C', 'L', 'O', 'G', '0', '1' };
+
+struct EventLogHeader
+{
+	char		magic[8];		// "INCLOG01"
+	uint32_t	recordSize;		// sizeof (IncidentEvent)
+	uint32_t	reserved;
+};
+
+const uint32_t IncidentEventLog::ALL;
+uint32_t IncidentEventLog::m_mask = 0;
+
+static std::vector<IncidentEvent> g_buffer;
+static uint32_t g_capacity = 4096;
+static uint32_t g_next = 0;				// Next slot of g_buffer
+static bool g_wrapped = false;			// g_buffer is full of unflushed events
+static uint64_t g_recorded = 0;
+static FILE *g_file = 0;
+static std::ostream *g_echo = 0;
+static bool g_closeScheduled = false;
+
+bool
+IncidentEventLog::Open (std::string file)
+{
+	NS_LOG_FUNCTION (file);
+
+	Close ();
+	g_file = fopen (file.c_str (), "wb");
+	if ( g_file == 0 )
+	{
+		NS_LOG_ERROR ("Unable to create event log " << file);
+		return false;
+	}
+
+	EventLogHeader header;
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, EVENT_LOG_MAGIC, sizeof (header.magic));
+	header.recordSize = sizeof (IncidentEvent);
+	fwrite (&header, sizeof (header), 1, g_file);
+
+	if ( !g_closeScheduled )
+	{
+		Simulator::ScheduleDestroy (&IncidentEventLog::Close);
+		g_closeScheduled = true;
+	}
+	return true;
+}
+
+void
+IncidentEventLog::Close (void)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+
+	if ( g_file != 0 )
+	{
+		Flush ();
+		fclose (g_file);
+		g_file = 0;
+	}
+	g_closeScheduled = false;
+}
+
+void
+IncidentEventLog::SetCapacity (uint32_t records)
+{
+	NS_ASSERT (records > 0);
+
+	Flush ();
+	g_capacity = records;
+	g_buffer.clear ();
+	g_next = 0;
+	g_wrapped = false;
+}
+
+void
+IncidentEventLog::SetMask (uint32_t mask)
+{
+	m_mask = mask & ALL;
+}
+
+uint32_t
+IncidentEventLog::GetMask (void)
+{
+	return m_mask;
+}
+
+void
+IncidentEventLog::SetEcho (std::ostream *os)
+{
+	g_echo = os;
+}
+
+IncidentEvent
+IncidentEventLog::Make (uint8_t kind, uint32_t node)
+{
+	IncidentEvent event;
+	memset (&event, 0, sizeof (event));
+	event.kind = kind;
+	event.time = Simulator::Now ().GetSeconds ();
+	event.node = node;
+	return event;
+}
+
+void
+IncidentEventLog::Record (const IncidentEvent &event)
+{
+	if ( g_buffer.empty () ) g_buffer.resize (g_capacity);
+
+	g_buffer[g_next] = event;
+	++g_recorded;
+	if ( ++g_next == g_buffer.size () )
+	{
+		g_next = 0;
+		g_wrapped = true;
+		if ( g_file != 0 ) WriteBlock ();
+	}
+
+	if ( g_echo != 0 ) Print (*g_echo, event);
+}
+
+void
+IncidentEventLog::Flush (void)
+{
+	if ( g_file == 0 ) return;
+
+	WriteBlock ();
+	fflush (g_file);
+}
+
+/*
+ * Writes out the unflushed events. With a file open, the buffer only
+ * wraps right before being written, so they are all in order.
+ */
+void
+IncidentEventLog::WriteBlock (void)
+{
+	uint32_t n = g_wrapped ? g_buffer.size () : g_next;
+	if ( n > 0 && fwrite (&g_buffer[0], sizeof (IncidentEvent), n, g_file) != n )
+	{
+		NS_LOG_ERROR ("Unable to write the event log");
+	}
+	g_next = 0;
+	g_wrapped = false;
+}
+
+void
+IncidentEventLog::GetRecent (std::vector<IncidentEvent> &events)
+{
+	events.clear ();
+	if ( g_wrapped ) events.insert (events.end (), g_buffer.begin () + g_next, g_buffer.end ());
+	events.insert (events.end (), g_buffer.begin (), g_buffer.begin () + g_next);
+}
+
+uint64_t
+IncidentEventLog::GetNRecorded (void)
+{
+	return g_recorded;
+}
+
+static const char *
+ActionString (uint8_t action)
+{
+	return action == 0 ? "INCREASE_REP" : "DECREASE_REP";
+}
+
+void
+IncidentEventLog::Print (std::ostream &os, const IncidentEvent &event)
+{
+	bool m = event.malicious != 0;
+	Ipv4Address src (event.src);
+	Ipv4Address dst (event.dst);
+
+	switch ( event.kind )
+	{
+	case IncidentEvent::GEN_INC:
+		os << "+" << event.time << " " << src << " " << dst << " " << "m=" << m << " "
+				<< "id=" << event.incidentId << " " << "[GEN_INC]" << std::endl;
+		break;
+
+	case IncidentEvent::BRD_RCVD:
+		os << "-" << event.time << " " << src << " " << dst << " " << "m=" << m << " "
+				<< "id=" << event.incidentId << " " << "[BRD_RCVD]" << std::endl;
+		break;
+
+	case IncidentEvent::CONF_SEND:
+		os << "+" << event.time << " " << src << " " << dst << " " << "m=" << m << " "
+				<< event.value[0] << "#" << event.value[1] << "#" << " " << "n=" << event.count
+				<< " " << "[CONF_SEND]" << std::endl;
+		break;
+
+	case IncidentEvent::CONF_RCVD:
+		os << "--" << event.value[0] << " " << event.value[1] << " " << event.count << " "
+				<< "id=" << event.incidentId << " " << "[CONF_RCVD]" << std::endl;
+		os << "-" << event.time << " " << src << " " << dst << " " << "m=" << m << " "
+				<< "r=" << event.value[0] << " " << "s=" << event.value[1] << " "
+				<< "k=" << (event.flag != 0) << " " << "[CONF_RCVD]" << std::endl;
+		break;
+
+	case IncidentEvent::VALIDATION:
+		// value: max_t, min_t, weight
+		os << "*" << event.time << " " << src << " " << "m=" << m << " ";
+		switch ( event.action )
+		{
+		case ABSOLUTE_VALUE_MODE:
+		case DENSITY_FUNCTION_MODE:
+			os << "max_t=" << (uint32_t) event.value[0] << " " << "min_t=" << (uint32_t) event.value[1]
+					<< " " << "nc=" << event.count << " " << "nn=" << event.count2 << " "
+					<< (event.action == ABSOLUTE_VALUE_MODE ? "[STATS-AV]" : "[STATS-DF]") << std::endl;
+			break;
+
+		case WEIGHT_FUNCTION_MODE:
+			os << "max_t=" << event.value[0] << " " << "min_t=" << event.value[1]
+					<< " " << "nc=" << event.count << " " << "w=" << event.value[2] << " " << "[STATS-WF]" << std::endl;
+			break;
+
+		default:
+			os << "max_t=" << event.value[0] << " " << "min_t=" << event.value[1]
+					<< " " << "nc=" << event.count << " " << "nn=" << event.count2 << " " << "[STATS-CUSTOM]" << std::endl;
+		}
+		break;
+
+	case IncidentEvent::STATS:
+		// value: alpha before and after, beta before and after, reputation before and after
+		os << "*" << event.time << " " << src << " " << "m=" << m << " " << "a=" << ActionString (event.action) << " ";
+		if ( event.action == 0 ) {
+			os << "alfa_b=" << event.value[0] << " " << "alfa_a=" << event.value[1]
+					<< " " << "beta=" << event.value[2] << " " << "[STATS]" << std::endl;
+		}
+		else {
+			os << "alfa=" << event.value[0] << " " << "beta_b=" << event.value[2]
+					<< " " << "beta_a=" << event.value[3] << " " << "[STATS]" << std::endl;
+		}
+		break;
+
+	case IncidentEvent::REP_UPDATE_SEND:
+		os << "+" << event.time << " " << src << " " << dst << " " << "m=" << m << " "
+				<< "a=" << ActionString (event.action) << " ";
+		if ( event.flag != 0 ) os << "n=" << event.count << " ";
+		os << "[REP_UPDATE]" << std::endl;
+		break;
+
+	case IncidentEvent::REP_UPDATE_RCVD:
+		os << "-" << event.time << " " << src << " " << dst << " " << "m=" << m << " "
+				<< "a=" << ActionString (event.action) << " " << "id=" << event.incidentId << " "
+				<< "[REP_UPDATE]" << std::endl;
+		break;
+
+	default:
+		os << "Unknown event " << (uint32_t) event.kind << std::endl;
+	}
+}
+
+bool
+IncidentEventLog::Decode (std::string file, std::ostream &os)
+{
+	FILE *in = fopen (file.c_str (), "rb");
+	if ( in == 0 )
+	{
+		NS_LOG_ERROR ("Unable to open event log " << file);
+		return false;
+	}
+
+	EventLogHeader header;
+	if ( fread (&header, sizeof (header), 1, in) != 1
+			|| memcmp (header.magic, EVENT_LOG_MAGIC, sizeof (EVENT_LOG_MAGIC)) != 0
+			|| header.recordSize != sizeof (IncidentEvent) )
+	{
+		NS_LOG_ERROR ("Malformed event log " << file);
+		fclose (in);
+		return false;
+	}
+
+	std::vector<IncidentEvent> block (4096);
+	size_t n;
+	while ( (n = fread (&block[0], sizeof (IncidentEvent), block.size (), in)) > 0 )
+	{
+		for ( size_t i = 0; i < n; i++ )
+		{
+			Print (os, block[i]);
+		}
+	}
+
+	fclose (in);
+	return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,177 @@
+/*
+ * incident-event-log.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef INCIDENT_EVENT_LOG_H_
+#define INCIDENT_EVENT_LOG_H_
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * The event log is compiled in unless INCIDENT_EVENTS_DISABLED is defined
+ * (e.g. CXXFLAGS=-DINCIDENT_EVENTS_DISABLED). When it is compiled out,
+ * INCIDENT_EVENT_ENABLED is constant false and the code filling the events
+ * is dropped by the compiler.
+ */
+#ifndef INCIDENT_EVENTS_DISABLED
+#define INCIDENT_EVENT_ENABLED(kind) (ns3::IncidentEventLog::IsEnabled (kind))
+#else
+#define INCIDENT_EVENT_ENABLED(kind) (false)
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Fixed-size record of something an IncidentGenerator or an
+ * IncidentSink did.
+ *
+ * Addresses are the Ipv4 addresses of the Nodes, as in the text logs.
+ * Unused fields are 0.
+ */
+struct IncidentEvent
+{
+	enum Kind
+	{
+		GEN_INC = 0,		// Generator broadcasts an incident
+		BRD_RCVD,			// Sink receives the broadcast
+		CONF_SEND,			// Sink sends its confirmations
+		CONF_RCVD,			// Generator receives a confirmation
+		VALIDATION,			// Generator decides on an incident
+		STATS,				// Reputation of a generator or a sink changes
+		REP_UPDATE_SEND,	// Generator sends a reputation update
+		REP_UPDATE_RCVD,	// Sink receives a reputation update
+		N_KINDS
+	};
+
+	uint8_t		kind;
+	uint8_t		malicious;		// The recording Node is malicious
+	uint8_t		flag;			// CONF_RCVD: kept; REP_UPDATE_SEND: batched
+	uint8_t		action;			// 0 increase, 1 decrease; VALIDATION: validation mode
+	uint32_t	incidentId;
+	double		time;			// Seconds
+	uint32_t	node;			// Id of the recording Node
+	uint32_t	src;
+	uint32_t	dst;
+	uint32_t	count;			// CONF_RCVD: packet size; CONF_SEND, REP_UPDATE_SEND: Nodes; VALIDATION: nc
+	uint32_t	count2;			// VALIDATION: nn
+	uint32_t	reserved;
+	double		value[6];		// See IncidentEventLog::Print
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief Binary log of IncidentEvent records, replacing the text lines
+ * ([GEN_INC], [CONF_RCVD], [STATS], ...) the applications used to log.
+ *
+ * Every kind of event is enabled separately at runtime with SetMask; by
+ * default nothing is recorded. Events go to a ring buffer of 'capacity'
+ * records. With a file open (Open), the buffer is written out in one block
+ * whenever it fills up and when the simulator is destroyed. Without one,
+ * the buffer keeps the most recent events (see GetRecent). Print and
+ * Decode turn the records back into the text lines, and SetEcho prints
+ * them as they are recorded.
+ *
+ * Like IncidenciesRegistry, the log is global to the simulation.
+ */
+class IncidentEventLog
+{
+public:
+	static const uint32_t ALL = (1 << IncidentEvent::N_KINDS) - 1;
+
+	/**
+	 * Writes the events to 'file' from now on. Returns false if it cannot
+	 * be created.
+	 */
+	static bool Open (std::string file);
+
+	/**
+	 * Writes out the buffered events and closes the file.
+	 */
+	static void Close (void);
+
+	static void SetCapacity (uint32_t records);
+
+	/**
+	 * \param mask bit (1 << kind) enables IncidentEvent::Kind 'kind'
+	 */
+	static void SetMask (uint32_t mask);
+	static uint32_t GetMask (void);
+
+	/**
+	 * Prints every event as it is recorded to 'os', or stops if 0.
+	 */
+	static void SetEcho (std::ostream *os);
+
+	static inline bool IsEnabled (uint32_t kind);
+
+	/**
+	 * \returns a record of 'kind' at the current time, for Node 'node'
+	 */
+	static IncidentEvent Make (uint8_t kind, uint32_t node);
+
+	static void Record (const IncidentEvent &event);
+
+	/**
+	 * Writes the buffered events to the file, if one is open.
+	 */
+	static void Flush (void);
+
+	/**
+	 * Fills 'events' with the buffered events, oldest first.
+	 */
+	static void GetRecent (std::vector<IncidentEvent> &events);
+
+	/**
+	 * \returns the events recorded since the log was created
+	 */
+	static uint64_t GetNRecorded (void);
+
+	/**
+	 * Prints 'event' as the line(s) the applications used to log.
+	 */
+	static void Print (std::ostream &os, const IncidentEvent &event);
+
+	/**
+	 * Prints all the events of 'file', a log written by Open.
+	 */
+	static bool Decode (std::string file, std::ostream &os);
+
+private:
+	static void WriteBlock (void);
+
+	static uint32_t	m_mask;
+};
+
+bool
+IncidentEventLog::IsEnabled (uint32_t kind)
+{
+	return (m_mask & (1 << kind)) != 0;
+}
+
+} // namespace ns3
+
+
+#endif /* INCIDENT_EVENT_LOG_H_ */
@@ -19,10 +19,13 @@
  * Author: Cristian Tanas <ctanas@deic.uab.cat>
  */
 
+#include <algorithm>
 #include <sstream>
+#include <stdlib.h>
 #include <math.h>
 
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv6-address.h"
@@ -37,14 +40,45 @@
 #include "ns3/trace-source-accessor.h"
 #include "ns3/double.h"
 #include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/pointer.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
 
 #include "incident-generator-application.h"
+#include "incident-confirmation-header.h"
+#include "reputation-update-header.h"
+#include "incident-broadcast-header.h"
+#include "incident-oracle.h"
+#include "incident-event-log.h"
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE("IncidentGeneratorApplication");
 NS_OBJECT_ENSURE_REGISTERED(IncidentGenerator);
 
+static const uint32_t INITIAL_CONFIRMATIONS = 16;	// Per incident, grown on demand
+static const uint32_t LEGACY_CONFIRMATION_SIZE = 64;	// Bytes of a text confirmation we look at
+
+/*
+ * Slot of 'key' in the open-addressing set 'slots', or of the free slot
+ * where it belongs. The size of 'slots' is a power of two and at least one
+ * slot is free.
+ */
+static uint32_t
+FindConfirmerSlot (const std::vector<uint32_t> &slots, uint32_t key)
+{
+	uint32_t mask = slots.size () - 1;
+	uint32_t hash = key;
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3b;
+	hash ^= hash >> 16;
+
+	uint32_t i = hash & mask;
+	while ( slots[i] != 0 && slots[i] != key ) i = (i + 1) & mask;
+	return i;
+}
+
 TypeId
 IncidentGenerator::GetTypeId (void)
 {
@@ -79,6 +113,10 @@ IncidentGenerator::GetTypeId (void)
 					UintegerValue (21),
 					MakeUintegerAccessor (&IncidentGenerator::m_weightFunction),
 					MakeUintegerChecker<uint32_t> ())
+			.AddAttribute ("WeightTable", "File with the (reputation, weight) points of the table-based weight function.",
+					StringValue (),
+					MakeStringAccessor (&IncidentGenerator::m_weightTable),
+					MakeStringChecker ())
 			.AddAttribute ("ConfirmationThreshold", "Minimum confirmations required.",
 					DoubleValue (1.),
 					MakeDoubleAccessor (&IncidentGenerator::m_confirmationThreshold),
@@ -91,10 +129,31 @@ IncidentGenerator::GetTypeId (void)
 					DoubleValue (0.9),
 					MakeDoubleAccessor (&IncidentGenerator::m_reputationThreshold),
 					MakeDoubleChecker<double> ())
+			.AddAttribute ("Validator", "Decides on the incidents. If not set, one is built from ValidationMode "
+					"and the threshold attributes. Validators keep no per-incident state and can be shared.",
+					PointerValue (),
+					MakePointerAccessor (&IncidentGenerator::m_validator),
+					MakePointerChecker<IncidentValidator> ())
 			.AddAttribute ("GenerationWeight", "Weight assigned to generated incidents.",
 					DoubleValue (1.),
 					MakeDoubleAccessor (&IncidentGenerator::m_generatedIncWeight),
 					MakeDoubleChecker<double> ())
+			.AddAttribute ("LegacyConfirmationFormat", "Expect '#'-delimited text confirmations instead of "
+					"an IncidentConfirmationHeader (needed to reproduce old traces).",
+					BooleanValue (false),
+					MakeBooleanAccessor (&IncidentGenerator::m_legacyConfirmationFormat),
+					MakeBooleanChecker ())
+			.AddAttribute ("BatchedReputationUpdates", "Broadcast a single reputation update listing all the "
+					"confirming Nodes instead of a unicast to each of them.",
+					BooleanValue (false),
+					MakeBooleanAccessor (&IncidentGenerator::m_batchedReputationUpdates),
+					MakeBooleanChecker ())
+			.AddAttribute ("EarlyDecision", "Validate an incident as soon as further confirmations cannot change "
+					"the outcome, instead of always waiting TimerDelay. Confirmations arriving after the "
+					"decision are ignored.",
+					BooleanValue (false),
+					MakeBooleanAccessor (&IncidentGenerator::m_earlyDecision),
+					MakeBooleanChecker ())
 	;
 
 	return tid;
@@ -107,19 +166,24 @@ IncidentGenerator::IncidentGenerator()
 	m_sent = 0;
 	m_socket = 0;
 	m_sendEvent = EventId ();
-	m_timer = Timer ();
+	m_lastIncidentId = 0;
 
 	m_NGeneratedIncidents = 0;
 
-	m_atLeastOneUserWithHR = 0;
-
 	m_selfishProb = .0;
 
 	m_validationMode = ABSOLUTE_VALUE_MODE;
+	m_validatorKind = ABSOLUTE_VALUE_MODE;
 	m_confirmedIncWeight = 1.;
 	m_maliciousNode = false;
-
-	srand (time (0));
+	m_legacyConfirmationFormat = false;
+	m_batchedReputationUpdates = false;
+	m_earlyDecision = false;
+	m_reputationState = 0;
+	m_nodeId = 0;
+	m_linkChangeHooked = false;
+
+	m_coin = CreateObject<UniformRandomVariable> ();
 }
 
 IncidentGenerator::~IncidentGenerator()
@@ -132,17 +196,33 @@ void
 IncidentGenerator::DoDispose (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  m_coin = 0;
+  m_oracle = 0;
+  m_validator = 0;
+  m_ipv4 = 0;
   Application::DoDispose ();
 }
 
+int64_t
+IncidentGenerator::AssignStreams (int64_t stream)
+{
+	NS_LOG_FUNCTION (this << stream);
+	m_coin->SetStream (stream);
+	return 1;
+}
+
+void
+IncidentGenerator::SetOracle (Ptr<IncidentOracle> oracle)
+{
+	NS_LOG_FUNCTION (this << oracle);
+	m_oracle = oracle;
+}
+
 void
 IncidentGenerator::StartApplication (void)
 {
 	NS_LOG_FUNCTION_NOARGS();
 
-	m_timer.SetFunction (&IncidentGenerator::AllConfirmationsReceived, this);
-	m_timer.SetDelay (m_timerDelay);
-
 	if ( m_socket == 0 )
 	{
 		TypeId tid = TypeId::LookupByName ("ns3::UdpSocketFactory");
@@ -155,6 +235,16 @@ IncidentGenerator::StartApplication (void)
 
 	m_socket->SetRecvCallback(MakeCallback (&IncidentGenerator::HandleConfirmations, this));
 
+	CacheLocalAddress ();
+	if ( !m_linkChangeHooked )
+	{
+		// Callbacks cannot be removed from the device, so it holds a
+		// reference to us instead of a raw pointer
+		m_ipv4->GetNetDevice (1)->AddLinkChangeCallback (
+				MakeCallback (&IncidentGenerator::CacheLocalAddress, Ptr<IncidentGenerator> (this)));
+		m_linkChangeHooked = true;
+	}
+
 	if ( !m_blackList.empty () )
 	{
 		std::stringstream ss (m_blackList);
@@ -166,8 +256,44 @@ IncidentGenerator::StartApplication (void)
 		}
 	}
 
-	DoubleValue selfishProb; GetNode ()->GetAttribute ("SelfishProb", selfishProb);
-	m_maliciousNode = selfishProb.Get () == -1 ? true : false;
+	if ( m_validator == 0 )
+	{
+		switch ( m_validationMode )
+		{
+		case ABSOLUTE_VALUE_MODE:
+			m_validator = CreateObject<AbsoluteIncidentValidator> ();
+			break;
+
+		case DENSITY_FUNCTION_MODE:
+			m_validator = CreateObject<DensityIncidentValidator> ();
+			break;
+
+		case WEIGHT_FUNCTION_MODE:
+			m_validator = CreateObject<WeightIncidentValidator> ();
+			m_validator->SetAttribute ("WeightFunction", UintegerValue (m_weightFunction));
+			m_validator->SetAttribute ("ReputationThreshold", DoubleValue (m_reputationThreshold));
+			m_validator->SetAttribute ("TableFile", StringValue (m_weightTable));
+			break;
+
+		default:
+			NS_ABORT_MSG ("IncidentGenerator: unknown validation mode " << m_validationMode);
+		}
+		m_validator->SetAttribute ("ConfirmationThreshold", DoubleValue (m_confirmationThreshold));
+		m_validator->SetAttribute ("DecreaseThreshold", DoubleValue (m_falseIncidentThreshold));
+	}
+	// Validators prepare their tables once, even when shared
+	m_validator->Start ();
+
+	// Subclasses of the built-in validators may override them, so only the
+	// exact types take the direct calls
+	TypeId validatorTid = m_validator->GetInstanceTypeId ();
+	if ( validatorTid == AbsoluteIncidentValidator::GetTypeId () ) m_validatorKind = ABSOLUTE_VALUE_MODE;
+	else if ( validatorTid == DensityIncidentValidator::GetTypeId () ) m_validatorKind = DENSITY_FUNCTION_MODE;
+	else if ( validatorTid == WeightIncidentValidator::GetTypeId () ) m_validatorKind = WEIGHT_FUNCTION_MODE;
+	else m_validatorKind = CUSTOM_VALIDATION_MODE;
+
+	m_reputationState = PeekPointer (GetNode ()->GetReputationState ());
+	m_maliciousNode = m_reputationState->GetSelfishness () == -1 ? true : false;
 
 //	GenerateNewIncident (m_startOffset);
 }
@@ -193,58 +319,195 @@ IncidentGenerator::GenerateNewIncident (Time dt)
 	m_sendEvent = Simulator::Schedule(dt, &IncidentGenerator::SendBroadcast, this);
 }
 
+uint32_t
+IncidentGenerator::GetNPendingIncidents (void) const
+{
+	return m_incidents.size () - m_freeIncidents.size ();
+}
+
+uint32_t
+IncidentGenerator::GetNIncidentRecords (void) const
+{
+	return m_incidents.size ();
+}
+
+IncidentGenerator::IncidentRecord *
+IncidentGenerator::AllocateIncident (void)
+{
+	uint32_t slot;
+	if ( !m_freeIncidents.empty () )
+	{
+		slot = m_freeIncidents.back ();
+		m_freeIncidents.pop_back ();
+	}
+	else
+	{
+		NS_ABORT_MSG_IF (m_incidents.size () > 0xffff, "IncidentGenerator: too many incidents in flight");
+		slot = m_incidents.size ();
+		m_incidents.push_back (IncidentRecord ());
+		m_incidents.back ().generation = 0;
+		m_incidents.back ().confirmations.reserve (INITIAL_CONFIRMATIONS);
+		m_incidents.back ().confirmers.assign (2 * INITIAL_CONFIRMATIONS, 0);
+		m_incidents.back ().nConfirmers = 0;
+	}
+
+	IncidentRecord *incident = &m_incidents[slot];
+	// Generation 0 is skipped so that no incident has id 0
+	if ( ++incident->generation == 0 ) incident->generation = 1;
+	incident->id = ((uint32_t) incident->generation << 16) | slot;
+	IncidentValidator::Reset (incident->validation);
+	incident->atLeastOneUserWithHR = 0;
+	return incident;
+}
+
+IncidentGenerator::IncidentRecord *
+IncidentGenerator::LookupIncident (uint32_t incidentId)
+{
+	uint32_t slot = incidentId & 0xffff;
+	if ( incidentId == 0 || slot >= m_incidents.size () || m_incidents[slot].id != incidentId ) return 0;
+	return &m_incidents[slot];
+}
+
+void
+IncidentGenerator::ReleaseIncident (IncidentRecord *incident)
+{
+	// Keep the capacity of the buffers for the next incident in this slot
+	incident->confirmations.clear ();
+	std::fill (incident->confirmers.begin (), incident->confirmers.end (), 0);
+	incident->nConfirmers = 0;
+	if ( m_lastIncidentId == incident->id ) m_lastIncidentId = 0;
+	incident->id = 0;
+	m_freeIncidents.push_back (incident - &m_incidents[0]);
+}
+
+/*
+ * Returns false if 'address' had already confirmed the incident. The set
+ * is kept at most half full.
+ */
+bool
+IncidentGenerator::InsertConfirmer (IncidentRecord &incident, Ipv4Address address)
+{
+	uint32_t key = address.Get ();
+	NS_ASSERT_MSG (key != 0, "IncidentGenerator: confirmation from 0.0.0.0");
+
+	uint32_t i = FindConfirmerSlot (incident.confirmers, key);
+	if ( incident.confirmers[i] == key ) return false;
+
+	if ( 2 * (incident.nConfirmers + 1) > incident.confirmers.size () )
+	{
+		std::vector<uint32_t> old (2 * incident.confirmers.size (), 0);
+		old.swap (incident.confirmers);
+		for ( uint32_t j = 0; j < old.size (); j++ )
+		{
+			if ( old[j] != 0 ) incident.confirmers[FindConfirmerSlot (incident.confirmers, old[j])] = old[j];
+		}
+		i = FindConfirmerSlot (incident.confirmers, key);
+	}
+
+	incident.confirmers[i] = key;
+	++incident.nConfirmers;
+	return true;
+}
+
 void
 IncidentGenerator::SendBroadcast (void)
 {
 	NS_LOG_FUNCTION_NOARGS();
 
-	NS_ASSERT (m_sendEvent.IsExpired());
+	// Every incident gets its own record, so broadcasts can overlap
+	IncidentRecord *incident = AllocateIncident ();
+	m_lastIncidentId = incident->id;
 
-	// Clear previous neighbours and saved reputation values
-	m_confirmationArray.clear ();
-	m_neighbours.clear ();
-	m_reputationMap.clear ();
-
-	Ptr<Packet> packet = Create<Packet> (512);
-	m_socket->Send(packet);
+	if ( m_oracle != 0 ) {
+		m_oracle->Broadcast (m_nodeId, incident->id);
+	}
+	else {
+		IncidentBroadcastHeader broadcast;
+		broadcast.SetIncidentId (incident->id);
+		Ptr<Packet> packet = Create<Packet> (512 - broadcast.GetSerializedSize ());
+		packet->AddHeader (broadcast);
+		m_socket->Send(packet);
+	}
 	++m_sent;
 
-	m_timer.Schedule ();
+	incident->timer = Simulator::Schedule (m_timerDelay, &IncidentGenerator::AllConfirmationsReceived,
+			this, incident->id);
 
-	// Get Node's local IP address
-	Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
-	Ipv4Address local = ipv4->GetAddress (1, 0).GetLocal ();
-
-	NS_LOG_INFO ("+" << Simulator::Now().GetSeconds () << " " << local << " " << "255.255.255.255"
-			<< " " << "m=" << m_maliciousNode << " " << "[GEN_INC]");
+	if ( INCIDENT_EVENT_ENABLED (IncidentEvent::GEN_INC) )
+	{
+		IncidentEvent event = MakeEvent (IncidentEvent::GEN_INC);
+		event.dst = Ipv4Address::GetBroadcast ().Get ();
+		event.incidentId = incident->id;
+		IncidentEventLog::Record (event);
+	}
 }
 
 void
-IncidentGenerator::SendReputationUpdate (uint8_t action)
+IncidentGenerator::SendReputationUpdate (const IncidentRecord &incident, uint8_t action)
 {
 	NS_LOG_FUNCTION_NOARGS ();
 
-	NS_ASSERT (m_sendEvent.IsExpired ());
-	Ptr<Packet> packet = Create<Packet> (256);
 	ReputationTag tag;
 	tag.SetDoAction (action);
-	packet->AddPacketTag (tag);
 
-	// Get Node's local IP address
-	Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
-	Ipv4Address local = ipv4->GetAddress (1, 0).GetLocal ();
+	ReputationUpdateHeader update;
+	update.SetAction (action);
+	update.SetIncidentId (incident.id);
 
-	std::vector<Address>::reverse_iterator rit;
+	std::vector<ConfirmationRecord>::const_reverse_iterator rit;
 
-	for ( rit = m_confirmationArray.rbegin (); rit < m_confirmationArray.rend (); ++rit)
+	// A single broadcast reaches all the confirming Nodes, which find
+	// themselves in the header. The oracle has no airtime to save
+	if ( m_batchedReputationUpdates && m_oracle == 0 && !incident.confirmations.empty () )
 	{
-		Ipv4Address sendToIp = InetSocketAddress::ConvertFrom (*rit).GetIpv4 ();
-		m_socket->SendTo (packet, 0, InetSocketAddress (sendToIp, 8089));
+		for ( rit = incident.confirmations.rbegin (); rit < incident.confirmations.rend (); ++rit)
+		{
+			update.AddAddress (rit->address);
+		}
+
+		Ptr<Packet> packet = Create<Packet> ();
+		packet->AddHeader (update);
+		tag.SetBatched (true);
+		packet->AddPacketTag (tag);
+		m_socket->Send (packet);
 		++m_sent;
 
-		std::string actionStr = action == 0 ? "INCREASE_REP" : "DECREASE_REP";
-		NS_LOG_INFO ("+" << Simulator::Now ().GetSeconds () << " " << local << " " << sendToIp
-				<< " " << "m=" << m_maliciousNode << " " << "a=" << actionStr << " " << "[REP_UPDATE]");
+		if ( INCIDENT_EVENT_ENABLED (IncidentEvent::REP_UPDATE_SEND) )
+		{
+			IncidentEvent event = MakeEvent (IncidentEvent::REP_UPDATE_SEND);
+			event.dst = Ipv4Address::GetBroadcast ().Get ();
+			event.action = action;
+			event.flag = 1;
+			event.count = update.GetNAddresses ();
+			event.incidentId = incident.id;
+			IncidentEventLog::Record (event);
+		}
+		return;
+	}
+
+	for ( rit = incident.confirmations.rbegin (); rit < incident.confirmations.rend (); ++rit)
+	{
+		Ipv4Address sendToIp = rit->address;
+		if ( m_oracle != 0 ) {
+			m_oracle->SendReputationUpdate (m_nodeId, InetSocketAddress (sendToIp, m_remotePort),
+					action, incident.id);
+		}
+		else {
+			Ptr<Packet> packet = Create<Packet> (256 - update.GetSerializedSize ());
+			packet->AddHeader (update);
+			packet->AddPacketTag (tag);
+			m_socket->SendTo (packet, 0, InetSocketAddress (sendToIp, m_remotePort));
+		}
+		++m_sent;
+
+		if ( INCIDENT_EVENT_ENABLED (IncidentEvent::REP_UPDATE_SEND) )
+		{
+			IncidentEvent event = MakeEvent (IncidentEvent::REP_UPDATE_SEND);
+			event.dst = sendToIp.Get ();
+			event.action = action;
+			event.incidentId = incident.id;
+			IncidentEventLog::Record (event);
+		}
 	}
 }
 
@@ -260,225 +523,288 @@ IncidentGenerator::HandleConfirmations (Ptr<Socket> socket)
 	{
 		double reputationVal = .0;
 		double selfishProb = .0;
+		uint32_t incidentId = 0;
+		uint32_t packetSize = packet->GetSize ();
 
-		uint8_t *buffer = new uint8_t [packet->GetSize ()];
-		memset(buffer, 0, packet->GetSize ());
-		packet->CopyData(buffer, packet->GetSize ());
-		std::stringstream ss; ss << buffer;
-//		ss >> reputationVal;
+		if ( m_legacyConfirmationFormat ) {
+			DecodeLegacyConfirmation (packet, reputationVal, selfishProb);
+			ProcessConfirmation (from, reputationVal, selfishProb, incidentId, packetSize);
+		}
+		else {
+			// A sink batching its confirmations sends several headers in one datagram
+			IncidentConfirmationHeader confirmation;
+			while ( packet->GetSize () >= confirmation.GetSerializedSize () )
+			{
+				packet->RemoveHeader (confirmation);
+				reputationVal = confirmation.GetReputation ();
+				selfishProb = confirmation.GetSelfishness ();
+				incidentId = confirmation.GetIncidentId ();
+				ProcessConfirmation (from, reputationVal, selfishProb, incidentId, packetSize);
+			}
+		}
+	}
+}
 
-		std::vector<std::string> elements;
-		std::string item;
-		while ( std::getline (ss, item, '#') )
-			elements.push_back (item);
+void
+IncidentGenerator::ProcessConfirmation (const Address &from, double reputationVal, double selfishProb,
+		uint32_t incidentId, uint32_t packetSize)
+{
+	NS_LOG_FUNCTION (this << from << reputationVal << selfishProb << incidentId);
 
-		NS_LOG_INFO ("--" << elements.at (0) << " " << elements.at (1) << " " << packet->GetSize () << " " << "[CONF_RCVD]");
+	IncidentRecord *incident = LookupIncident (incidentId != 0 ? incidentId : m_lastIncidentId);
+	if ( incident == 0 )
+	{
+		NS_LOG_WARN ("Dropping confirmation of incident " << incidentId << ", no longer waiting for it");
+		return;
+	}
 
-		// Get Reputation value from the packet received
-		std::stringstream repStrToDouble; repStrToDouble << elements.at (0); repStrToDouble >> reputationVal;
-		// Get SelfishProb value from the packet received
-		std::stringstream selStrToDouble; selStrToDouble << elements.at (1); selStrToDouble >> selfishProb;
+//	NS_LOG_INFO ("[CONF_RCVD] " << Simulator::Now ().GetSeconds () << " " << local << " " << packet->GetSize () << " " <<
+//				InetSocketAddress::ConvertFrom (from).GetIpv4 () << " " <<
+//				InetSocketAddress::ConvertFrom (from).GetPort ());
 
-		Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
-		Ipv4Address local = ipv4->GetAddress (1, 0).GetLocal ();
-//		NS_LOG_INFO ("[CONF_RCVD] " << Simulator::Now ().GetSeconds () << " " << local << " " << packet->GetSize () << " " <<
-//					InetSocketAddress::ConvertFrom (from).GetIpv4 () << " " <<
-//					InetSocketAddress::ConvertFrom (from).GetPort ());
+	Ipv4Address fromAddress = InetSocketAddress::ConvertFrom (from).GetIpv4 ();
 
-		Ipv4Address fromAddress = InetSocketAddress::ConvertFrom (from).GetIpv4 ();
+	// The Incident Generator Nodes decides which confirmations are valid based on the
+	// selfishness probability of the Node that confirmed
+	bool keepConfirmation;
+	if ( !m_maliciousNode ) {
+		keepConfirmation = TossBiasedCoin (selfishProb);
+	}
+	else {
+		keepConfirmation = (selfishProb == -1);
+	}
 
-		m_neighbours.push_back (from);
+	if ( INCIDENT_EVENT_ENABLED (IncidentEvent::CONF_RCVD) )
+	{
+		IncidentEvent event = MakeEvent (IncidentEvent::CONF_RCVD);
+		event.dst = event.src;
+		event.src = fromAddress.Get ();
+		event.incidentId = incidentId;
+		event.count = packetSize;
+		event.flag = keepConfirmation;
+		event.value[0] = reputationVal;
+		event.value[1] = selfishProb;
+		IncidentEventLog::Record (event);
+	}
 
-		// The Incident Generator Nodes decides which confirmations are valid based on the
-		// selfishness probability of the Node that confirmed
-		bool keepConfirmation;
-		if ( !m_maliciousNode ) {
-			keepConfirmation = TossBiasedCoin (selfishProb);
-		}
-		else {
-			keepConfirmation = (selfishProb == -1);
-		}
+	IncidentValidator::Answer answer;
+	answer.reputation = reputationVal;
+	answer.selfishness = selfishProb;
+	answer.kept = keepConfirmation;
+	answer.firstFromNode = false;
 
-		NS_LOG_INFO ("-" << Simulator::Now ().GetSeconds () << " " << fromAddress << " " << local
-				<< " " << "m=" << m_maliciousNode << " " << "r=" << reputationVal << " " << "s=" << selfishProb
-				<< " " << "k=" << keepConfirmation << " " << "[CONF_RCVD]");
+	if ( keepConfirmation )
+	{
+		ConfirmationRecord confirmation;
+		confirmation.address = fromAddress;
+		confirmation.reputation = reputationVal;
+		confirmation.selfishness = selfishProb;
+		confirmation.arrival = Simulator::Now ();
+		incident->confirmations.push_back (confirmation);
+
+		if ( reputationVal >= m_reputationThreshold ) {
+			incident->atLeastOneUserWithHR = 1;
+		}
+		answer.firstFromNode = InsertConfirmer (*incident, fromAddress);
+	}
 
-		if ( keepConfirmation )
-		{
-			m_confirmationArray.push_back(from);
+	AddToValidation (*incident, answer);
 
-			if ( reputationVal >= m_reputationThreshold ) {
-				m_atLeastOneUserWithHR = 1;
-			}
-			m_reputationMap.insert (std::pair<Ipv4Address, double> (fromAddress, reputationVal));
-		}
+	if ( keepConfirmation && m_earlyDecision && IsIncidentDecided (*incident, m_reputationState->GetReputation ()) )
+	{
+		Simulator::Cancel (incident->timer);
+		AllConfirmationsReceived (incident->id);
 	}
 }
 
 void
-IncidentGenerator::AllConfirmationsReceived (void)
+IncidentGenerator::AddToValidation (IncidentRecord &incident, const IncidentValidator::Answer &answer)
 {
-	NS_LOG_FUNCTION_NOARGS ();
-
-//	NS_LOG_INFO ("At time " << Simulator::Now ().GetSeconds () << "s confirmation timer has expired.");
-//	NS_LOG_INFO ("Confirmation list:");
-//	for (unsigned int i = 0; i < m_confirmationArray.size (); i++)
-//	{
-//		Ipv4Address ip = InetSocketAddress::ConvertFrom (m_confirmationArray.at (i)).GetIpv4 ();
-//		NS_LOG_INFO (ip);
-//	}
-
-	// Print statistics. |Time | ConfirmationThreshold | #ConfirmationsReceived | #Neighbours|
-//	NS_LOG_INFO ("[STATS] " << Simulator::Now ().GetSeconds () << " " << m_confirmationThreshold <<
-//			" " << m_confirmationArray.size () << " " << m_neighbours.size ());
-
-//	NS_LOG_INFO ("m_confirmationArray=" << m_confirmationArray.size () << ", m_confirmationThreshold=" << m_confirmationThreshold);
-//	std::string cond = m_confirmationArray.size()>m_confirmationThreshold ? "true" : "false";
-//	NS_LOG_INFO (cond);
-	Ipv4Address local = GetNode ()->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ();
-	DoubleValue myReputation; GetNode ()->GetAttribute ("Reputation", myReputation);
-
-	uint32_t doAction = ValidateIncidentWithMode (m_validationMode);
-	DoubleValue validIncidents, invalidIncidents;
-	double newValidIncidents, newInvalidIncidents;
-	std::string doActionStr;
-	switch ( doAction ) {
-	case INCREASE_REPUTATION:
-		doActionStr = "INCREASE_REP";
-		GetNode ()->GetAttribute ("ValidIncidents", validIncidents);
-		GetNode ()->GetAttribute ("InvalidIncidents", invalidIncidents);
-		newValidIncidents = validIncidents.Get () + m_generatedIncWeight;
-		GetNode ()->SetAttribute ("ValidIncidents", DoubleValue (newValidIncidents));
-
-		NS_LOG_INFO ("*" << Simulator::Now ().GetSeconds () << " " << local << " "
-				<< "m=" << m_maliciousNode << " " << "a=" << doActionStr << " "
-				<< "alfa_b=" << validIncidents.Get () << " " << "alfa_a=" << newValidIncidents
-				<< " " << "beta=" << invalidIncidents.Get () << " " << "[STATS]");
-
-		if ( myReputation.Get () != 1 ) UpdateNodeReputation();
-		SendReputationUpdate (0);
+	switch ( m_validatorKind )
+	{
+	case ABSOLUTE_VALUE_MODE:
+		IncidentValidatorAdd<AbsoluteIncidentValidator> (*m_validator, incident.validation, answer);
 		break;
 
-	case DECREASE_REPUTATION:
-		doActionStr = "DECREASE_REP";
-		GetNode ()->GetAttribute ("ValidIncidents", validIncidents);
-		GetNode ()->GetAttribute ("InvalidIncidents", invalidIncidents);
-		newInvalidIncidents = invalidIncidents.Get () + 1;
-		GetNode ()->SetAttribute ("InvalidIncidents", DoubleValue (newInvalidIncidents));
-
-		NS_LOG_INFO ("*" << Simulator::Now ().GetSeconds () << " " << local << " "
-				<< "m=" << m_maliciousNode << " " << "a=" << doActionStr << " "
-				<< "alfa=" << validIncidents.Get ()
-				<< " " << "beta_b=" << invalidIncidents.Get () << " " << "beta_a=" << newInvalidIncidents << " " << "[STATS]");
-
-		UpdateNodeReputation ();
-		SendReputationUpdate (1);
+	case DENSITY_FUNCTION_MODE:
+		IncidentValidatorAdd<DensityIncidentValidator> (*m_validator, incident.validation, answer);
 		break;
 
-	case DO_NOTHING:
-		doActionStr = "DO_NOTHING";
+	case WEIGHT_FUNCTION_MODE:
+		IncidentValidatorAdd<WeightIncidentValidator> (*m_validator, incident.validation, answer);
 		break;
 
 	default:
-		break;
+		m_validator->Add (incident.validation, answer);
 	}
 }
 
-uint32_t
-IncidentGenerator::ValidateIncidentWithMode (uint32_t validationMode)
+int32_t
+IncidentGenerator::DecideIncident (const IncidentRecord &incident, double ownReputation)
 {
-	Ipv4Address local = GetNode ()->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ();
-	uint32_t requiredConfirmations = 0;
-	uint32_t minConfirmations = 0;
-
-	DoubleValue myReputation;
-	double weight = .0;
-	switch ( validationMode )
+	switch ( m_validatorKind )
 	{
 	case ABSOLUTE_VALUE_MODE:
-		requiredConfirmations = (uint32_t) m_confirmationThreshold;
-		minConfirmations = (uint32_t) m_falseIncidentThreshold;
-		NS_LOG_INFO ("*" << Simulator::Now ().GetSeconds () << " " << local << " " << "m=" << m_maliciousNode <<
-				" " << "max_t=" << requiredConfirmations <<
-				" " << "min_t=" << minConfirmations << " " << "nc=" << m_confirmationArray.size () <<
-				" " << "nn=" << m_neighbours.size () << " " << "[STATS-AV]");
-		if ( m_confirmationArray.size () >= requiredConfirmations ) return INCREASE_REPUTATION;
-		else if ( m_confirmationArray.size () <= minConfirmations ) return DECREASE_REPUTATION;
-		return  DO_NOTHING;
+		return IncidentValidatorDecide<AbsoluteIncidentValidator> (*m_validator, incident.validation, ownReputation);
 
 	case DENSITY_FUNCTION_MODE:
-		requiredConfirmations = (uint32_t) ceil (m_neighbours.size () * m_confirmationThreshold);
-		minConfirmations = (uint32_t) ceil (m_neighbours.size () * m_falseIncidentThreshold);
-		NS_LOG_INFO ("*" << Simulator::Now ().GetSeconds () << " " << local << " " << "m=" << m_maliciousNode <<
-						" " << "max_t=" << requiredConfirmations <<
-						" " << "min_t=" << minConfirmations << " " << "nc=" << m_confirmationArray.size () <<
-						" " << "nn=" << m_neighbours.size () << " " << "[STATS-DF]");
-		if ( m_confirmationArray.size () >= requiredConfirmations ) return INCREASE_REPUTATION;
-		else if ( m_confirmationArray.size () <= minConfirmations ) return DECREASE_REPUTATION;
-		return  DO_NOTHING;
+		return IncidentValidatorDecide<DensityIncidentValidator> (*m_validator, incident.validation, ownReputation);
 
 	case WEIGHT_FUNCTION_MODE:
-		GetNode ()->GetAttribute ("Reputation", myReputation);
-		weight += GetConfirmationWeight (myReputation.Get ());
-		for ( std::map<Ipv4Address, double>::iterator it = m_reputationMap.begin (); it != m_reputationMap.end (); ++it )
-		{
-			weight += GetConfirmationWeight (it->second);
-		}
-		NS_LOG_INFO ("*" << Simulator::Now ().GetSeconds () << " " << local << " " << "m=" << m_maliciousNode <<
-						" " << "max_t=" << m_confirmationThreshold <<
-						" " << "min_t=" << m_falseIncidentThreshold << " " << "nc=" << m_reputationMap.size () <<
-						" " << "w=" << weight << " " << "[STATS-WF]");
-		if ( weight >= m_confirmationThreshold) return INCREASE_REPUTATION;
-		else if ( weight <= m_falseIncidentThreshold ) return DECREASE_REPUTATION;
-		return DO_NOTHING;
+		return IncidentValidatorDecide<WeightIncidentValidator> (*m_validator, incident.validation, ownReputation);
 
 	default:
-		return false;
+		return m_validator->Decide (incident.validation, ownReputation);
 	}
 }
 
-void
-IncidentGenerator::UpdateNodeReputation (void)
+bool
+IncidentGenerator::IsIncidentDecided (const IncidentRecord &incident, double ownReputation)
 {
-	DoubleValue nValidIncidents;
-	GetNode ()->GetAttribute ("ValidIncidents", nValidIncidents);
-	DoubleValue nInvalidIncidents;
-	GetNode ()->GetAttribute ("InvalidIncidents", nInvalidIncidents);
+	switch ( m_validatorKind )
+	{
+	case ABSOLUTE_VALUE_MODE:
+		return IncidentValidatorIsFinal<AbsoluteIncidentValidator> (*m_validator, incident.validation, ownReputation);
+
+	case DENSITY_FUNCTION_MODE:
+		return IncidentValidatorIsFinal<DensityIncidentValidator> (*m_validator, incident.validation, ownReputation);
+
+	case WEIGHT_FUNCTION_MODE:
+		return IncidentValidatorIsFinal<WeightIncidentValidator> (*m_validator, incident.validation, ownReputation);
 
-	double newReputationVal = (nValidIncidents.Get () + 1) /
-			(nValidIncidents.Get () + nInvalidIncidents.Get () + 2);
-	GetNode()->SetAttribute ("Reputation", DoubleValue (newReputationVal));
-//	NS_LOG_INFO ("Reputation value of Node " << GetNode()->GetId () <<
-//			" changed and the new value is " << rep.Get ());
+	default:
+		return m_validator->IsFinal (incident.validation, ownReputation);
+	}
 }
 
-bool
-IncidentGenerator::TossBiasedCoin (double bias)
+void
+IncidentGenerator::DecodeLegacyConfirmation (Ptr<Packet> packet, double &reputationVal, double &selfishProb)
 {
-	double randomNumber = rand () / double (RAND_MAX);
-	bool accept = randomNumber < bias ? false : true;
-	return accept;
+	// "<reputation>#<selfishness>#". Both values fit in the buffer; anything
+	// past them is ignored
+	char buffer[LEGACY_CONFIRMATION_SIZE];
+	uint32_t size = packet->CopyData (reinterpret_cast<uint8_t *> (buffer), sizeof (buffer) - 1);
+	buffer[size] = '\0';
+
+	char *end;
+	reputationVal = strtod (buffer, &end);
+	if ( *end == '#' ) {
+		selfishProb = strtod (end + 1, &end);
+	}
+	if ( *end != '#' ) {
+		NS_LOG_WARN ("IncidentGenerator: malformed legacy confirmation \"" << buffer << "\"");
+	}
 }
 
-double
-IncidentGenerator::GetConfirmationWeight (double reputationVal)
+void
+IncidentGenerator::AllConfirmationsReceived (uint32_t incidentId)
 {
-//	NS_LOG_INFO ("[GET_WEIGHT] " << Simulator::Now ().GetSeconds () << " GetConfirmationWeight function called with "
-//			"reputationVal = " << reputationVal);
-	switch ( m_weightFunction )
+	NS_LOG_FUNCTION (this << incidentId);
+
+	IncidentRecord *incident = LookupIncident (incidentId);
+	NS_ASSERT (incident != 0);
+
+	double myReputation = m_reputationState->GetReputation ();
+
+	if ( INCIDENT_EVENT_ENABLED (IncidentEvent::VALIDATION) )
 	{
-	case LINEAR_WEIGHT_FUN:
-		return reputationVal / m_reputationThreshold;
+		IncidentEvent event = MakeEvent (IncidentEvent::VALIDATION);
+		event.incidentId = incident->id;
+		m_validator->GetStats (incident->validation, myReputation, event);
+		IncidentEventLog::Record (event);
+	}
+	int32_t doAction = DecideIncident (*incident, myReputation);
+	double validIncidents = m_reputationState->GetValidIncidents ();
+	double invalidIncidents = m_reputationState->GetInvalidIncidents ();
+	switch ( doAction ) {
+	case INCREASE_REPUTATION:
+		m_reputationState->SetValidIncidents (validIncidents + m_generatedIncWeight);
+		if ( myReputation != 1 ) UpdateNodeReputation();
+		RecordStats (0, validIncidents, invalidIncidents, myReputation);
+		SendReputationUpdate (*incident, 0);
+		break;
 
-	case EXP_WEIGHT_FUN:
-		return exp (4 * (reputationVal - m_reputationThreshold));
+	case DECREASE_REPUTATION:
+		m_reputationState->SetInvalidIncidents (invalidIncidents + 1);
+		UpdateNodeReputation ();
+		RecordStats (1, validIncidents, invalidIncidents, myReputation);
+		SendReputationUpdate (*incident, 1);
+		break;
 
-	case QUADRATIC_WEIGHT_FUN:
-		return reputationVal * reputationVal;
+	case DO_NOTHING:
+		break;
 
 	default:
-		return .0;
+		break;
 	}
+
+	ReleaseIncident (incident);
+}
+
+/*
+ * Resolves our Ipv4, address and node id once, so that the packet paths do
+ * not look up the aggregates. Ipv4 has no address change notification in
+ * this version of ns-3; the cache is refreshed when the link of interface 1
+ * goes up or down instead, which is when the interface gets (re)configured
+ * in our scenarios.
+ */
+void
+IncidentGenerator::CacheLocalAddress (void)
+{
+	if ( GetNode () == 0 ) return;	// Disposed
+
+	m_nodeId = GetNode ()->GetId ();
+	m_ipv4 = GetNode ()->GetObject<Ipv4> ();
+	m_local = m_ipv4->GetAddress (1, 0).GetLocal ();
+	NS_LOG_LOGIC ("Node " << m_nodeId << " local address " << m_local);
+}
+
+IncidentEvent
+IncidentGenerator::MakeEvent (uint8_t kind)
+{
+	IncidentEvent event = IncidentEventLog::Make (kind, m_nodeId);
+	event.malicious = m_maliciousNode;
+	event.src = m_local.Get ();
+	return event;
+}
+
+/*
+ * Records the change of our reputation state by 'action', from 'alpha',
+ * 'beta' and 'reputation' to their current values.
+ */
+void
+IncidentGenerator::RecordStats (uint8_t action, double alpha, double beta, double reputation)
+{
+	if ( !INCIDENT_EVENT_ENABLED (IncidentEvent::STATS) ) return;
+
+	IncidentEvent event = MakeEvent (IncidentEvent::STATS);
+	event.action = action;
+	event.value[0] = alpha;
+	event.value[1] = m_reputationState->GetValidIncidents ();
+	event.value[2] = beta;
+	event.value[3] = m_reputationState->GetInvalidIncidents ();
+	event.value[4] = reputation;
+	event.value[5] = m_reputationState->GetReputation ();
+	IncidentEventLog::Record (event);
+}
+
+void
+IncidentGenerator::UpdateNodeReputation (void)
+{
+	double nValidIncidents = m_reputationState->GetValidIncidents ();
+	double nInvalidIncidents = m_reputationState->GetInvalidIncidents ();
+
+	double newReputationVal = (nValidIncidents + 1) /
+			(nValidIncidents + nInvalidIncidents + 2);
+	m_reputationState->SetReputation (newReputationVal);
+}
+
+bool
+IncidentGenerator::TossBiasedCoin (double bias)
+{
+	double randomNumber = m_coin->GetValue ();
+	bool accept = randomNumber < bias ? false : true;
+	return accept;
 }
 
 
@@ -487,6 +813,8 @@ IncidentGenerator::GetConfirmationWeight (double reputationVal)
  ***************************************************************/
 
 ReputationTag::ReputationTag ()
+	: m_doAction (0),
+	  m_batched (false)
 {
 
 }
@@ -503,6 +831,18 @@ ReputationTag::GetDoAction (void) const
   return m_doAction;
 }
 
+void
+ReputationTag::SetBatched (bool batched)
+{
+  m_batched = batched;
+}
+
+bool
+ReputationTag::IsBatched (void) const
+{
+  return m_batched;
+}
+
 NS_OBJECT_ENSURE_REGISTERED (ReputationTag);
 
 TypeId
@@ -523,22 +863,24 @@ ReputationTag::GetInstanceTypeId (void) const
 uint32_t
 ReputationTag::GetSerializedSize (void) const
 {
-  return 1;
+  return 2;
 }
 void
 ReputationTag::Serialize (TagBuffer i) const
 {
   i.WriteU8 (m_doAction);
+  i.WriteU8 (m_batched ? 1 : 0);
 }
 void
 ReputationTag::Deserialize (TagBuffer i)
 {
   m_doAction = i.ReadU8 ();
+  m_batched = i.ReadU8 () != 0;
 }
 void
 ReputationTag::Print (std::ostream &os) const
 {
-  os << "Action=" << (uint32_t) m_doAction;
+  os << "Action=" << (uint32_t) m_doAction << " Batched=" << m_batched;
 }
 
 } // namespace ns3
@@ -26,31 +26,24 @@
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
-#include "ns3/timer.h"
 #include "ns3/tag.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/nstime.h"
 
-#include <map>
+#include <vector>
+
+#include "incident-validator.h"
 
 #define CONFIRMATION_THRESHOLD 1
 #define REPUTATION_THRESHOLD 0.9
 
-#define ABSOLUTE_VALUE_MODE 0
-#define DENSITY_FUNCTION_MODE 1
-#define WEIGHT_FUNCTION_MODE 2
-
-#define LINEAR_WEIGHT_FUN 21
-#define EXP_WEIGHT_FUN 22
-#define QUADRATIC_WEIGHT_FUN 23
-#define TABLE_WEIGHT_FUN 24
-
-#define INCREASE_REPUTATION 1
-#define DECREASE_REPUTATION -1
-#define DO_NOTHING 0
-
 namespace ns3 {
 
 class Socket;
 class Packet;
+class ReputationState;
+class IncidentOracle;
+class Ipv4;
 
 class IncidentGenerator : public Application
 {
@@ -62,25 +55,102 @@ public:
 
 	void GenerateNewIncident (Time dt);
 
+	/**
+	 * Assign a fixed random variable stream number to the random variables
+	 * used by this application.
+	 *
+	 * \param stream first stream index to use
+	 * \return the number of stream indices assigned by this application
+	 */
+	int64_t AssignStreams (int64_t stream);
+
+	/**
+	 * Resolve broadcasts and reputation updates through 'oracle' instead
+	 * of the sockets. Set by IncidentOracle::Install.
+	 */
+	void SetOracle (Ptr<IncidentOracle> oracle);
+
+	/**
+	 * Handles a confirmation of incident 'incidentId' sent by 'from'. Called
+	 * for every confirmation read from the socket, or directly by the
+	 * oracle. Confirmations without id (0, legacy format) go to the last
+	 * incident broadcast.
+	 */
+	void ProcessConfirmation (const Address &from, double reputationVal, double selfishProb,
+			uint32_t incidentId, uint32_t packetSize);
+
+	/**
+	 * \returns the incidents waiting for their confirmations
+	 */
+	uint32_t GetNPendingIncidents (void) const;
+
+	/**
+	 * \returns the incident records allocated, in use or not
+	 */
+	uint32_t GetNIncidentRecords (void) const;
+
 protected:
 	virtual void DoDispose (void);
 
 private:
+	/**
+	 * A confirmation kept by the generator.
+	 */
+	struct ConfirmationRecord
+	{
+		Ipv4Address	address;		// Of the confirming Node
+		double		reputation;
+		double		selfishness;
+		Time		arrival;
+	};
+
+	/**
+	 * An incident waiting for its confirmations. Records live in a slab and
+	 * are recycled once the incident is validated; their id is the slot in
+	 * the low 16 bits and a generation count in the high 16 bits, so late
+	 * confirmations of a recycled slot are told apart. A recycled record
+	 * keeps the capacity of its buffers, so once the slab is warm no
+	 * confirmation allocates.
+	 */
+	struct IncidentRecord
+	{
+		uint32_t						id;			// 0 while the slot is free
+		uint16_t						generation;
+		EventId							timer;		// End of the confirmation window
+		std::vector<ConfirmationRecord>	confirmations;	// Kept confirmations, in arrival order
+		std::vector<uint32_t>			confirmers;		// Open-addressing set of the confirming addresses, 0 if free
+		uint32_t						nConfirmers;
+		IncidentValidator::State		validation;
+		uint8_t 						atLeastOneUserWithHR;
+	};
 
 	virtual void StartApplication (void);
 	virtual void StopApplication (void);
 
 	void SendBroadcast (void);
-	void SendReputationUpdate (uint8_t action);
+	void SendReputationUpdate (const IncidentRecord &incident, uint8_t action);
 
 	void HandleConfirmations (Ptr<Socket> socket);
-	void AllConfirmationsReceived (void);
-	uint32_t ValidateIncidentWithMode (uint32_t validationMode);
+	void DecodeLegacyConfirmation (Ptr<Packet> packet, double &reputationVal, double &selfishProb);
+	void AllConfirmationsReceived (uint32_t incidentId);
+
+	// Validator calls, without virtual dispatch for the built-in validators
+	void AddToValidation (IncidentRecord &incident, const IncidentValidator::Answer &answer);
+	int32_t DecideIncident (const IncidentRecord &incident, double ownReputation);
+	bool IsIncidentDecided (const IncidentRecord &incident, double ownReputation);
+
+	IncidentRecord *AllocateIncident (void);
+	IncidentRecord *LookupIncident (uint32_t incidentId);
+	void ReleaseIncident (IncidentRecord *incident);
+	bool InsertConfirmer (IncidentRecord &incident, Ipv4Address address);
 
 	void UpdateNodeReputation (void);
 
+	void CacheLocalAddress (void);
+	IncidentEvent MakeEvent (uint8_t kind);
+	void RecordStats (uint8_t action, double alpha, double beta, double reputation);
+
 	bool TossBiasedCoin (double bias);
-	double GetConfirmationWeight (double reputationVal);
 
 	Time		m_startOffset;	// Time interval before generating any incident
 
@@ -91,13 +161,11 @@ private:
 
 	EventId		m_sendEvent;
 
-	Timer		m_timer;		// Timer to wait for broadcast confirmations
-	Time		m_timerDelay;	// Timer schedule delay
+	Time		m_timerDelay;	// Time to wait for broadcast confirmations
 
-	std::vector<Address> 			m_confirmationArray;
-	std::vector<Address>			m_neighbours;
-	std::map<Ipv4Address, double> 	m_reputationMap;
-	uint8_t 						m_atLeastOneUserWithHR;
+	std::vector<IncidentRecord>	m_incidents;		// Slab of in-flight incidents
+	std::vector<uint32_t>		m_freeIncidents;	// Free slots of m_incidents
+	uint32_t					m_lastIncidentId;	// Receives the confirmations without id
 
 	uint32_t	m_NGeneratedIncidents;	// Nombre d'incidències generades
 
@@ -107,14 +175,33 @@ private:
 
 	uint32_t	m_validationMode;
 	uint32_t	m_weightFunction;
+	std::string	m_weightTable;
 	double		m_confirmationThreshold;
 	double		m_falseIncidentThreshold;
 	double		m_reputationThreshold;
 
+	Ptr<IncidentValidator>	m_validator;
+	uint32_t				m_validatorKind;	// Validation mode of m_validator, CUSTOM_VALIDATION_MODE if not built-in
+
 	double		m_confirmedIncWeight;
 	double 		m_generatedIncWeight;
 
 	bool 		m_maliciousNode;
+
+	ReputationState	*m_reputationState;	// Reputation state aggregated to our Node
+
+	Ptr<UniformRandomVariable>	m_coin;	// Decides which confirmations are kept
+
+	bool		m_legacyConfirmationFormat;	// Expect '#'-delimited text confirmations
+	bool		m_batchedReputationUpdates;	// One broadcast update per incident instead of one unicast per confirmer
+	bool		m_earlyDecision;			// Validate as soon as the outcome cannot change
+
+	Ptr<IncidentOracle>	m_oracle;		// Delivers our messages when set, bypassing the sockets
+
+	Ptr<Ipv4>	m_ipv4;			// Cached by CacheLocalAddress
+	Ipv4Address	m_local;		// Our address on interface 1
+	uint32_t	m_nodeId;
+	bool		m_linkChangeHooked;
 };
 
 
@@ -125,6 +212,13 @@ public:
 	void SetDoAction (uint8_t action);
 	uint8_t GetDoAction (void) const;
 
+	/**
+	 * Batched updates carry a ReputationUpdateHeader with the Nodes they
+	 * apply to.
+	 */
+	void SetBatched (bool batched);
+	bool IsBatched (void) const;
+
 	static TypeId GetTypeId (void);
 	virtual TypeId GetInstanceTypeId (void) const;
 	virtual uint32_t GetSerializedSize (void) const;
@@ -134,6 +228,7 @@ public:
 
 private:
 	uint8_t		m_doAction;
+	bool		m_batched;
 };
 
 } // namespace ns3
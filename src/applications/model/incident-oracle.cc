@@ -0,0 +1,238 @@
+/*
+ * incident-oracle.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/node.h"
+#include "ns3/ipv4.h"
+#include "ns3/inet-socket-address.h"
+
+#include "incident-oracle.h"
+#include "incidencies-registry.h"
+#include "incident-generator-application.h"
+#include "incident-sink-application.h"
+#include "incident-confirmation-header.h"
+#include "spatial-grid-index.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("IncidentOracle");
+NS_OBJECT_ENSURE_REGISTERED(IncidentOracle);
+
+static const uint32_t NOT_INDEXED = 0xffffffff;
+
+TypeId
+IncidentOracle::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::IncidentOracle")
+			.SetParent<Object> ()
+			.AddConstructor<IncidentOracle> ()
+			.AddAttribute ("Range", "Distance, in meters, up to which messages are received.",
+					DoubleValue (250.),
+					MakeDoubleAccessor (&IncidentOracle::m_range),
+					MakeDoubleChecker<double> (0.))
+			.AddAttribute ("BroadcastDelay", "Time for a broadcast to reach the nodes in range.",
+					TimeValue (MilliSeconds (2)),
+					MakeTimeAccessor (&IncidentOracle::m_broadcastDelay),
+					MakeTimeChecker ())
+			.AddAttribute ("UnicastDelay", "Time for a confirmation or a reputation update to be delivered.",
+					TimeValue (MilliSeconds (2)),
+					MakeTimeAccessor (&IncidentOracle::m_unicastDelay),
+					MakeTimeChecker ())
+	;
+
+	return tid;
+}
+
+IncidentOracle::IncidentOracle ()
+	: m_range (250.),
+	  m_lost (0)
+{
+}
+
+IncidentOracle::~IncidentOracle ()
+{
+}
+
+void
+IncidentOracle::DoDispose (void)
+{
+	m_grid = 0;
+	Object::DoDispose ();
+}
+
+void
+IncidentOracle::Install (NodeContainer nodes, Ptr<SpatialGridIndex> grid)
+{
+	NS_LOG_FUNCTION (this << grid);
+
+	m_grid = grid;
+	if ( m_grid == 0 )
+	{
+		m_grid = CreateObject<SpatialGridIndex> ();
+		m_grid->SetAttribute ("CellSize", DoubleValue (m_range));
+		m_grid->Install (nodes);
+	}
+	NS_ASSERT_MSG (m_grid->GetN () == nodes.GetN (), "IncidentOracle: the grid indexes other nodes");
+
+	m_nodeIdOf.resize (nodes.GetN ());
+	for ( uint32_t i = 0; i < nodes.GetN (); i++ )
+	{
+		Ptr<Node> node = nodes.Get (i);
+		uint32_t nodeId = node->GetId ();
+		Ipv4Address address = node->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ();
+
+		if ( nodeId >= m_indexOf.size () )
+		{
+			m_indexOf.resize (nodeId + 1, NOT_INDEXED);
+			m_addresses.resize (nodeId + 1);
+		}
+		m_indexOf[nodeId] = i;
+		m_nodeIdOf[i] = nodeId;
+		m_addresses[nodeId] = address;
+		m_nodeByAddress[address] = nodeId;
+
+		Ptr<IncidentGenerator> generator = IncidenciesRegistry::GetGenerator (nodeId);
+		if ( generator != 0 ) generator->SetOracle (this);
+
+		Ptr<IncidentSink> sink = IncidenciesRegistry::GetSink (nodeId);
+		if ( sink != 0 ) sink->SetOracle (this);
+	}
+}
+
+Ptr<SpatialGridIndex>
+IncidentOracle::GetSpatialIndex (void) const
+{
+	return m_grid;
+}
+
+uint32_t
+IncidentOracle::GetLostMessages (void) const
+{
+	return m_lost;
+}
+
+void
+IncidentOracle::Broadcast (uint32_t nodeId, uint32_t incidentId)
+{
+	NS_LOG_FUNCTION (this << nodeId << incidentId);
+
+	NS_ASSERT (nodeId < m_indexOf.size () && m_indexOf[nodeId] != NOT_INDEXED);
+	m_grid->GetNodesInRange (m_indexOf[nodeId], m_range, m_neighbours);
+
+	for ( uint32_t i = 0; i < m_neighbours.size (); i++ )
+	{
+		Simulator::Schedule (m_broadcastDelay, &IncidentOracle::DeliverBroadcast, this,
+				nodeId, m_nodeIdOf[m_neighbours[i]], incidentId);
+	}
+}
+
+void
+IncidentOracle::SendConfirmation (uint32_t nodeId, const Address &to, double reputation, double selfishness,
+		uint32_t incidentId)
+{
+	NS_LOG_FUNCTION (this << nodeId << to);
+
+	uint32_t toId;
+	if ( !Lookup (to, toId) ) return;
+	Simulator::Schedule (m_unicastDelay, &IncidentOracle::DeliverConfirmation, this,
+			nodeId, toId, reputation, selfishness, incidentId);
+}
+
+void
+IncidentOracle::SendReputationUpdate (uint32_t nodeId, const Address &to, uint8_t action, uint32_t incidentId)
+{
+	NS_LOG_FUNCTION (this << nodeId << to << (uint32_t) action);
+
+	uint32_t toId;
+	if ( !Lookup (to, toId) ) return;
+	Simulator::Schedule (m_unicastDelay, &IncidentOracle::DeliverReputationUpdate, this,
+			nodeId, toId, action, incidentId);
+}
+
+void
+IncidentOracle::DeliverBroadcast (uint32_t from, uint32_t to, uint32_t incidentId)
+{
+	Ptr<IncidentSink> sink = IncidenciesRegistry::GetSink (to);
+	if ( sink == 0 ) return;
+
+	sink->ProcessBroadcast (InetSocketAddress (m_addresses[from]), incidentId);
+}
+
+void
+IncidentOracle::DeliverConfirmation (uint32_t from, uint32_t to, double reputation, double selfishness,
+		uint32_t incidentId)
+{
+	Ptr<IncidentGenerator> generator = IncidenciesRegistry::GetGenerator (to);
+	if ( generator == 0 ) return;
+
+	if ( !InRange (from, to) )
+	{
+		NS_LOG_LOGIC ("Confirmation from node " << from << " to node " << to << " lost, out of range");
+		++m_lost;
+		return;
+	}
+
+	IncidentConfirmationHeader confirmation;
+	generator->ProcessConfirmation (InetSocketAddress (m_addresses[from]), reputation, selfishness,
+			incidentId, confirmation.GetSerializedSize ());
+}
+
+void
+IncidentOracle::DeliverReputationUpdate (uint32_t from, uint32_t to, uint8_t action, uint32_t incidentId)
+{
+	Ptr<IncidentSink> sink = IncidenciesRegistry::GetSink (to);
+	if ( sink == 0 ) return;
+
+	if ( !InRange (from, to) )
+	{
+		NS_LOG_LOGIC ("Reputation update from node " << from << " to node " << to << " lost, out of range");
+		++m_lost;
+		return;
+	}
+
+	sink->ProcessReputationUpdate (InetSocketAddress (m_addresses[from]), action, incidentId);
+}
+
+bool
+IncidentOracle::Lookup (const Address &address, uint32_t &nodeId) const
+{
+	std::map<Ipv4Address, uint32_t>::const_iterator it =
+			m_nodeByAddress.find (InetSocketAddress::ConvertFrom (address).GetIpv4 ());
+	if ( it == m_nodeByAddress.end () )
+	{
+		NS_LOG_WARN ("IncidentOracle: no node has address " << InetSocketAddress::ConvertFrom (address).GetIpv4 ());
+		return false;
+	}
+	nodeId = it->second;
+	return true;
+}
+
+bool
+IncidentOracle::InRange (uint32_t a, uint32_t b) const
+{
+	Vector pa = m_grid->GetPosition (m_indexOf[a]);
+	Vector pb = m_grid->GetPosition (m_indexOf[b]);
+	return CalculateDistance (pa, pb) <= m_range;
+}
+
+} // namespace ns3
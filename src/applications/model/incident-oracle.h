@@ -0,0 +1,125 @@
+/*
+ * incident-oracle.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef INCIDENT_ORACLE_H_
+#define INCIDENT_ORACLE_H_
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node-container.h"
+
+namespace ns3 {
+
+class SpatialGridIndex;
+
+/**
+ * \ingroup applications
+ *
+ * \brief Delivers the messages of IncidentGenerator and IncidentSink without
+ * going through the wifi stack.
+ *
+ * Once installed, the applications hand their broadcasts, confirmations and
+ * reputation updates to the oracle instead of their sockets. A broadcast
+ * reaches every node within 'Range' meters of the sender (the MaxRange of
+ * the RangePropagationLossModel) after 'BroadcastDelay'; a confirmation or
+ * reputation update reaches its destination after 'UnicastDelay' if both
+ * nodes are still in range by then. Receivers run the same code they run for
+ * packets read from their sockets, so validation and reputation behave as in
+ * the full simulation, minus collisions and MAC losses.
+ *
+ * The nodes must have a MobilityModel, an Ipv4 address and their
+ * applications registered in IncidenciesRegistry.
+ */
+class IncidentOracle : public Object
+{
+public:
+	static TypeId GetTypeId (void);
+
+	IncidentOracle ();
+	virtual ~IncidentOracle ();
+
+	/**
+	 * Switches the applications of 'nodes' to the oracle. 'grid' must index
+	 * the same container; if it is 0 the oracle builds its own.
+	 */
+	void Install (NodeContainer nodes, Ptr<SpatialGridIndex> grid = 0);
+
+	/**
+	 * Node 'nodeId' broadcasts incident 'incidentId'.
+	 */
+	void Broadcast (uint32_t nodeId, uint32_t incidentId);
+
+	/**
+	 * Node 'nodeId' confirms incident 'incidentId', broadcast by 'to'.
+	 */
+	void SendConfirmation (uint32_t nodeId, const Address &to, double reputation, double selfishness,
+			uint32_t incidentId);
+
+	/**
+	 * Node 'nodeId' sends reputation update 'action' for incident
+	 * 'incidentId' to 'to'.
+	 */
+	void SendReputationUpdate (uint32_t nodeId, const Address &to, uint8_t action, uint32_t incidentId);
+
+	Ptr<SpatialGridIndex> GetSpatialIndex (void) const;
+
+	/**
+	 * \returns the confirmations and reputation updates dropped so far
+	 * because their nodes were no longer in range
+	 */
+	uint32_t GetLostMessages (void) const;
+
+protected:
+	virtual void DoDispose (void);
+
+private:
+	void DeliverBroadcast (uint32_t from, uint32_t to, uint32_t incidentId);
+	void DeliverConfirmation (uint32_t from, uint32_t to, double reputation, double selfishness,
+			uint32_t incidentId);
+	void DeliverReputationUpdate (uint32_t from, uint32_t to, uint8_t action, uint32_t incidentId);
+
+	bool Lookup (const Address &address, uint32_t &nodeId) const;
+	bool InRange (uint32_t a, uint32_t b) const;
+
+	double		m_range;
+	Time		m_broadcastDelay;
+	Time		m_unicastDelay;
+
+	Ptr<SpatialGridIndex>			m_grid;
+	std::vector<uint32_t>			m_indexOf;		// Grid index of every node id
+	std::vector<uint32_t>			m_nodeIdOf;		// Node id of every grid index
+	std::vector<Ipv4Address>		m_addresses;	// Indexed by node id
+	std::map<Ipv4Address, uint32_t>	m_nodeByAddress;
+	std::vector<uint32_t>			m_neighbours;
+
+	uint32_t	m_lost;		// Unicasts dropped because the nodes moved apart
+};
+
+} // namespace ns3
+
+
+#endif /* INCIDENT_ORACLE_H_ */
@@ -0,0 +1,149 @@
+/*
+ * incident-scheduler.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/node.h"
+
+#include "incident-scheduler.h"
+#include "incident-generator-application.h"
+#include "incidencies-registry.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("IncidentScheduler");
+NS_OBJECT_ENSURE_REGISTERED(IncidentScheduler);
+
+TypeId
+IncidentScheduler::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::IncidentScheduler")
+			.SetParent<Object> ()
+			.AddConstructor<IncidentScheduler> ()
+			.AddTraceSource ("Incident", "A node has been told to generate an incident (incident id, node index).",
+					MakeTraceSourceAccessor (&IncidentScheduler::m_incidentTrace))
+	;
+
+	return tid;
+}
+
+IncidentScheduler::IncidentScheduler ()
+	: m_nextIncidentId (0),
+	  m_generated (0)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+
+	m_random = CreateObject<UniformRandomVariable> ();
+}
+
+IncidentScheduler::~IncidentScheduler ()
+{
+	NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+IncidentScheduler::DoDispose (void)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+
+	Simulator::Cancel (m_randomEvent);
+	m_nodes = NodeContainer ();
+	m_random = 0;
+	Object::DoDispose ();
+}
+
+void
+IncidentScheduler::SetNodes (NodeContainer nodes)
+{
+	m_nodes = nodes;
+}
+
+NodeContainer
+IncidentScheduler::GetNodes (void) const
+{
+	return m_nodes;
+}
+
+void
+IncidentScheduler::ScheduleIncident (Time delay, uint32_t nodeId)
+{
+	NS_ASSERT_MSG (nodeId < m_nodes.GetN (), "IncidentScheduler: unknown node " << nodeId);
+	Simulator::Schedule (delay, &IncidentScheduler::Dispatch, this, nodeId, m_nextIncidentId++);
+}
+
+void
+IncidentScheduler::GenerateIncident (uint32_t nodeId)
+{
+	NS_ASSERT_MSG (nodeId < m_nodes.GetN (), "IncidentScheduler: unknown node " << nodeId);
+	Dispatch (nodeId, m_nextIncidentId++);
+}
+
+void
+IncidentScheduler::StartRandomIncidents (Time start, Time interval)
+{
+	m_interval = interval;
+	Simulator::Cancel (m_randomEvent);
+	m_randomEvent = Simulator::Schedule (start, &IncidentScheduler::RandomIncident, this);
+}
+
+void
+IncidentScheduler::StopRandomIncidents (void)
+{
+	Simulator::Cancel (m_randomEvent);
+}
+
+void
+IncidentScheduler::RandomIncident (void)
+{
+	uint32_t nodeId = (uint32_t) (m_nodes.GetN () * m_random->GetValue ());
+	GenerateIncident (nodeId);
+
+	m_randomEvent = Simulator::Schedule (m_interval, &IncidentScheduler::RandomIncident, this);
+}
+
+void
+IncidentScheduler::Dispatch (uint32_t nodeId, uint32_t incidentId)
+{
+	NS_LOG_INFO ("At time " << Simulator::Now().GetSeconds () << " Node " << nodeId << " was selected.");
+
+	Ptr<IncidentGenerator> genApp = IncidenciesRegistry::GetGenerator (m_nodes.Get (nodeId)->GetId ());
+	NS_ASSERT_MSG (genApp != 0, "IncidentScheduler: Node " << nodeId << " has no IncidentGenerator");
+	genApp->GenerateNewIncident (Seconds (.0));
+	m_generated++;
+
+	m_incidentTrace (incidentId, nodeId);
+}
+
+uint32_t
+IncidentScheduler::GetGeneratedIncidents (void) const
+{
+	return m_generated;
+}
+
+int64_t
+IncidentScheduler::AssignStreams (int64_t stream)
+{
+	m_random->SetStream (stream);
+	return 1;
+}
+
+} // namespace ns3
@@ -0,0 +1,109 @@
+/*
+ * incident-scheduler.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef INCIDENT_SCHEDULER_H_
+#define INCIDENT_SCHEDULER_H_
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/node-container.h"
+#include "ns3/traced-callback.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Dispatches incidents to the IncidentGenerator of the nodes.
+ *
+ * The scheduler owns the set of nodes that may generate incidents, so the
+ * events it puts in the simulator queue only carry a node index and an
+ * incident id, never a copy of the node set.
+ */
+class IncidentScheduler : public Object
+{
+public:
+	static TypeId GetTypeId (void);
+
+	IncidentScheduler ();
+	virtual ~IncidentScheduler ();
+
+	/**
+	 * \param nodes the nodes incidents are dispatched to; node indexes
+	 * below refer to this container
+	 */
+	void SetNodes (NodeContainer nodes);
+	NodeContainer GetNodes (void) const;
+
+	/**
+	 * Node 'nodeId' generates an incident after 'delay'.
+	 */
+	void ScheduleIncident (Time delay, uint32_t nodeId);
+
+	/**
+	 * Node 'nodeId' generates an incident now.
+	 */
+	void GenerateIncident (uint32_t nodeId);
+
+	/**
+	 * A random node generates an incident every 'interval', the first one
+	 * after 'start'.
+	 */
+	void StartRandomIncidents (Time start, Time interval);
+	void StopRandomIncidents (void);
+
+	uint32_t GetGeneratedIncidents (void) const;
+
+	/**
+	 * Assign a fixed random variable stream number to the random variables
+	 * used by this object.
+	 *
+	 * \param stream first stream index to use
+	 * \return the number of stream indices assigned by this object
+	 */
+	int64_t AssignStreams (int64_t stream);
+
+protected:
+	virtual void DoDispose (void);
+
+private:
+	void Dispatch (uint32_t nodeId, uint32_t incidentId);
+	void RandomIncident (void);
+
+	NodeContainer	m_nodes;
+
+	uint32_t	m_nextIncidentId;
+	uint32_t	m_generated;			// Number of incidents dispatched
+
+	Time		m_interval;				// Random incidents generation interval
+	EventId		m_randomEvent;
+
+	Ptr<UniformRandomVariable>	m_random;	// Selects the node of random incidents
+
+	TracedCallback<uint32_t, uint32_t>	m_incidentTrace;	// Incident id, node index
+};
+
+} // namespace ns3
+
+
+#endif /* INCIDENT_SCHEDULER_H_ */
@@ -34,10 +34,17 @@
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
 #include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
 
-#include <ctime>
 #include "incident-sink-application.h"
 #include "incident-generator-application.h"
+#include "incident-confirmation-header.h"
+#include "reputation-update-header.h"
+#include "incident-broadcast-header.h"
+#include "incident-oracle.h"
+#include "incident-event-log.h"
 
 namespace ns3 {
 
@@ -58,6 +65,17 @@ IncidentSink::GetTypeId (void)
 					DoubleValue (1.),
 					MakeDoubleAccessor (&IncidentSink::m_confirmedIncWeight),
 					MakeDoubleChecker<double> ())
+			.AddAttribute("LegacyConfirmationFormat", "Send confirmations as '#'-delimited text instead of "
+					"an IncidentConfirmationHeader (needed to reproduce old traces).",
+					BooleanValue (false),
+					MakeBooleanAccessor (&IncidentSink::m_legacyConfirmationFormat),
+					MakeBooleanChecker ())
+			.AddAttribute("ConfirmationWindow", "Confirmations for the same generator queued within this "
+					"time of the first one are sent together in one datagram (0 disables batching). "
+					"Together with the 0.1-0.5s jitter it must stay below the generator TimerDelay.",
+					TimeValue (Seconds (0)),
+					MakeTimeAccessor (&IncidentSink::m_confirmationWindow),
+					MakeTimeChecker ())
 	;
 	return tid;
 }
@@ -68,8 +86,13 @@ IncidentSink::IncidentSink ()
 
 	m_NConfirmations = 0;
 	m_maliciousNode = false;
+	m_legacyConfirmationFormat = false;
+	m_reputationState = 0;
+	m_nodeId = 0;
+	m_linkChangeHooked = false;
 
-	srand (time (0));
+	m_coin = CreateObject<UniformRandomVariable> ();
+	m_jitter = CreateObject<UniformRandomVariable> ();
 }
 
 IncidentSink::~IncidentSink ()
@@ -84,9 +107,29 @@ void
 IncidentSink::DoDispose (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
+  m_coin = 0;
+  m_jitter = 0;
+  m_oracle = 0;
+  m_ipv4 = 0;
   Application::DoDispose ();
 }
 
+int64_t
+IncidentSink::AssignStreams (int64_t stream)
+{
+	NS_LOG_FUNCTION (this << stream);
+	m_coin->SetStream (stream);
+	m_jitter->SetStream (stream + 1);
+	return 2;
+}
+
+void
+IncidentSink::SetOracle (Ptr<IncidentOracle> oracle)
+{
+	NS_LOG_FUNCTION (this << oracle);
+	m_oracle = oracle;
+}
+
 void
 IncidentSink::StartApplication (void)
 {
@@ -109,8 +152,18 @@ IncidentSink::StartApplication (void)
 
 	m_socket->SetRecvCallback (MakeCallback (&IncidentSink::HandleRead, this));
 
-	DoubleValue selfishProb; GetNode ()->GetAttribute ("SelfishProb", selfishProb);
-	m_maliciousNode = selfishProb.Get () == -1 ? true : false;
+	CacheLocalAddress ();
+	if ( !m_linkChangeHooked )
+	{
+		// Callbacks cannot be removed from the device, so it holds a
+		// reference to us instead of a raw pointer
+		m_ipv4->GetNetDevice (1)->AddLinkChangeCallback (
+				MakeCallback (&IncidentSink::CacheLocalAddress, Ptr<IncidentSink> (this)));
+		m_linkChangeHooked = true;
+	}
+
+	m_reputationState = PeekPointer (GetNode ()->GetReputationState ());
+	m_maliciousNode = m_reputationState->GetSelfishness () == -1 ? true : false;
 }
 
 void
@@ -131,29 +184,93 @@ IncidentSink::StopApplication (void)
 }
 
 void
-IncidentSink::SendConfirmation (Address remote)
+IncidentSink::SendConfirmation (Address remote, uint32_t incidentId)
 {
-	DoubleValue myReputation; GetNode()->GetAttribute ("Reputation", myReputation);
-	DoubleValue mySelfishness; GetNode ()->GetAttribute ("SelfishProb", mySelfishness);
+	SendConfirmations (remote, std::vector<uint32_t> (1, incidentId));
+}
 
-	std::string myReputationStr = myReputation.SerializeToString (MakeDoubleChecker<double> ());
-	myReputationStr.append ("#");
-	std::string mySelfishnessStr = mySelfishness.SerializeToString (MakeDoubleChecker<double> ());
-	myReputationStr.append (mySelfishnessStr);
-	myReputationStr.append ("#");
-	Ptr<Packet> confirmationPkt = Create<Packet> (reinterpret_cast<const uint8_t*> (myReputationStr.c_str ()),
-			myReputationStr.length ());
+void
+IncidentSink::QueueConfirmation (const Address &remote, uint32_t incidentId, Time delay)
+{
+	std::map<Address, std::vector<uint32_t> >::iterator it = m_pendingConfirmations.find (remote);
+	if ( it != m_pendingConfirmations.end () )
+	{
+		it->second.push_back (incidentId);
+		return;
+	}
 
-	m_socketResp->Connect (remote);
-	m_socketResp->Send (confirmationPkt);
+	m_pendingConfirmations[remote].push_back (incidentId);
+	Simulator::Schedule (delay + m_confirmationWindow, &IncidentSink::FlushConfirmations, this, remote);
+}
 
-	++m_NConfirmations;
+void
+IncidentSink::FlushConfirmations (Address remote)
+{
+	std::map<Address, std::vector<uint32_t> >::iterator it = m_pendingConfirmations.find (remote);
+	if ( it == m_pendingConfirmations.end () ) return;
 
-	Ptr<Ipv4> ipv4 = GetNode ()->GetObject<Ipv4> ();
-	Ipv4Address local = ipv4->GetAddress (1, 0).GetLocal ();
+	std::vector<uint32_t> incidentIds;
+	incidentIds.swap (it->second);
+	m_pendingConfirmations.erase (it);
+	SendConfirmations (remote, incidentIds);
+}
 
-	NS_LOG_INFO ("+"<< Simulator::Now ().GetSeconds () << " " << local << " " << InetSocketAddress::ConvertFrom (remote).GetIpv4 () << " "
-			<< "m=" << m_maliciousNode << " " << myReputationStr << " " << "[CONF_SEND]");
+/*
+ * Batched confirmations are one IncidentConfirmationHeader per incident,
+ * back to back in one datagram.
+ */
+void
+IncidentSink::SendConfirmations (Address remote, const std::vector<uint32_t> &incidentIds)
+{
+	double myReputation = m_reputationState->GetReputation ();
+	double mySelfishness = m_reputationState->GetSelfishness ();
+	uint32_t count = incidentIds.size ();
+
+	Ptr<Packet> confirmationPkt;
+	if ( m_oracle != 0 )
+	{
+		for ( uint32_t n = 0; n < count; n++ )
+		{
+			m_oracle->SendConfirmation (m_nodeId, remote, myReputation, mySelfishness, incidentIds[n]);
+		}
+	}
+	else if ( m_legacyConfirmationFormat )
+	{
+		std::string myReputationStr = DoubleValue (myReputation).SerializeToString (MakeDoubleChecker<double> ());
+		myReputationStr.append ("#");
+		std::string mySelfishnessStr = DoubleValue (mySelfishness).SerializeToString (MakeDoubleChecker<double> ());
+		myReputationStr.append (mySelfishnessStr);
+		myReputationStr.append ("#");
+		confirmationPkt = Create<Packet> (reinterpret_cast<const uint8_t*> (myReputationStr.c_str ()),
+				myReputationStr.length ());
+		m_socketResp->SendTo (confirmationPkt, 0, remote);
+	}
+	else
+	{
+		IncidentConfirmationHeader confirmation;
+		confirmation.SetReputation (myReputation);
+		confirmation.SetSelfishness (mySelfishness);
+		confirmationPkt = Create<Packet> ();
+		for ( uint32_t n = count; n > 0; n-- )	// Headers are prepended
+		{
+			confirmation.SetIncidentId (incidentIds[n - 1]);
+			confirmationPkt->AddHeader (confirmation);
+		}
+		m_socketResp->SendTo (confirmationPkt, 0, remote);
+	}
+
+	m_NConfirmations += count;
+
+	if ( INCIDENT_EVENT_ENABLED (IncidentEvent::CONF_SEND) )
+	{
+		IncidentEvent event = MakeEvent (IncidentEvent::CONF_SEND);
+		event.dst = InetSocketAddress::ConvertFrom (remote).GetIpv4 ().Get ();
+		event.incidentId = count > 0 ? incidentIds[0] : 0;
+		event.count = count;
+		event.value[0] = myReputation;
+		event.value[1] = mySelfishness;
+		IncidentEventLog::Record (event);
+	}
 }
 
 void
@@ -166,105 +283,158 @@ IncidentSink::HandleRead (Ptr<Socket> socket)
 
 	while ( (packet = socket->RecvFrom (from)) )
 	{
-		Ipv4Address fromAddress = InetSocketAddress::ConvertFrom (from).GetIpv4 ();
 		ReputationTag tag;
 		bool reputationUpdate = packet->RemovePacketTag (tag);
 
-		if ( reputationUpdate ) // Received reputation update packet and the Node must update its reputation
+		if ( reputationUpdate && tag.IsBatched () ) // Broadcast update, only for the listed Nodes
 		{
-			uint8_t action = tag.GetDoAction ();
-			std::string actionStr = action == 0 ? "INCREASE_REP" : "DECREASE_REP";
-
-			Ipv4Address localhost = GetNode ()->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ();
-			NS_LOG_INFO ("-" << Simulator::Now ().GetSeconds () << " " << fromAddress << " " << localhost
-					<< " " << "m=" << m_maliciousNode << " " << "a=" << actionStr << " " << "[REP_UPDATE]");
-
-			if ( action == 0 ) {
-				DoubleValue nValidIncidents, nInvalidIncidents;
-				GetNode ()->GetAttribute ("ValidIncidents", nValidIncidents);
-				GetNode ()->GetAttribute ("InvalidIncidents", nInvalidIncidents);
-				double newValidIncidents = nValidIncidents.Get () + m_confirmedIncWeight;
-				GetNode ()->SetAttribute ("ValidIncidents", DoubleValue (newValidIncidents));
-
-				NS_LOG_INFO ("*" << Simulator::Now ().GetSeconds () << " " << localhost << " "
-						<< "m=" << m_maliciousNode << " " << "a=" << actionStr << " "
-						<< "alfa_b=" << nValidIncidents.Get () << " " << "alfa_a=" << newValidIncidents
-						<< " " << "beta=" << nInvalidIncidents.Get () << " " << "[STATS]");
-
-				DoubleValue myReputation; GetNode ()->GetAttribute ("Reputation", myReputation);
-				if ( myReputation.Get () != 1 ) UpdateReputation ();
-			}
-			else if ( action == 1 ) {
-				DoubleValue nValidIncidents, nInvalidIncidents;
-				GetNode ()->GetAttribute ("ValidIncidents", nValidIncidents);
-				GetNode ()->GetAttribute ("InvalidIncidents", nInvalidIncidents);
-				double newInvalidIncidents = nInvalidIncidents.Get () + 1;
-				GetNode ()->SetAttribute ("InvalidIncidents", DoubleValue (newInvalidIncidents));
-
-				NS_LOG_INFO ("*" << Simulator::Now ().GetSeconds () << " " << localhost << " "
-						<< "m=" << m_maliciousNode << " " << "a=" << actionStr << " "
-						<< "alfa=" << nValidIncidents.Get () << " " << "beta_b=" << nInvalidIncidents.Get ()
-						<< " " << "beta_a=" << newInvalidIncidents << " " << "[STATS]");
-
-				UpdateReputation ();
+			ReputationUpdateHeader update;
+			packet->RemoveHeader (update);
+			if ( update.Contains (m_local) ) {
+				ProcessReputationUpdate (from, update.GetAction (), update.GetIncidentId ());
 			}
 		}
+		else if ( reputationUpdate ) // Received reputation update packet and the Node must update its reputation
+		{
+			ReputationUpdateHeader update;
+			packet->RemoveHeader (update);
+			ProcessReputationUpdate (from, tag.GetDoAction (), update.GetIncidentId ());
+		}
 		else { // Received broadcast message (i.e. an incident was generated)
+			IncidentBroadcastHeader broadcast;
+			packet->RemoveHeader (broadcast);
+			ProcessBroadcast (from, broadcast.GetIncidentId ());
+		}
+	}
+}
 
-			Ipv4Address localhost = GetNode ()->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ();
-			NS_LOG_INFO ("-" << Simulator::Now ().GetSeconds () << " " << fromAddress << " " << localhost
-					<< " " << "m=" << m_maliciousNode << " " << "[BRD_RCVD]");
+uint32_t
+IncidentSink::GetNPendingConfirmations (void) const
+{
+	uint32_t n = 0;
+	for ( std::map<Address, std::vector<uint32_t> >::const_iterator it = m_pendingConfirmations.begin ();
+			it != m_pendingConfirmations.end (); ++it )
+	{
+		n += it->second.size ();
+	}
+	return n;
+}
 
-			DoubleValue selfishProb = DoubleValue (.0);
-			bool shouldIConfirm = TossBiasedCoin(selfishProb.Get ());
-			if ( shouldIConfirm ) {
-				double delay = RandomNumberInterval (0.1, 0.5);
-				Simulator::Schedule(Seconds (delay), &IncidentSink::SendConfirmation, this, from);
-			}
-			//SendConfirmation (from, Seconds (0));
+void
+IncidentSink::ProcessReputationUpdate (const Address &from, uint8_t action, uint32_t incidentId)
+{
+	NS_LOG_FUNCTION (this << from << (uint32_t) action << incidentId);
+
+	if ( INCIDENT_EVENT_ENABLED (IncidentEvent::REP_UPDATE_RCVD) )
+	{
+		IncidentEvent event = MakeEvent (IncidentEvent::REP_UPDATE_RCVD);
+		event.dst = event.src;
+		event.src = InetSocketAddress::ConvertFrom (from).GetIpv4 ().Get ();
+		event.action = action;
+		event.incidentId = incidentId;
+		IncidentEventLog::Record (event);
+	}
+
+	if ( action != 0 && action != 1 ) return;
+
+	double nValidIncidents = m_reputationState->GetValidIncidents ();
+	double nInvalidIncidents = m_reputationState->GetInvalidIncidents ();
+	double reputation = m_reputationState->GetReputation ();
+	if ( action == 0 ) {
+		m_reputationState->SetValidIncidents (nValidIncidents + m_confirmedIncWeight);
+		if ( reputation != 1 ) UpdateReputation ();
+	}
+	else {
+		m_reputationState->SetInvalidIncidents (nInvalidIncidents + 1);
+		UpdateReputation ();
+	}
 
-			//NS_LOG_LOGIC ("Sending confirmation...");
-			//socket->SendTo(packet, 0, from);
-			//m_socketResp->Connect (from);
-			//m_socketResp->Send (Create<Packet> (512));
+	if ( INCIDENT_EVENT_ENABLED (IncidentEvent::STATS) )
+	{
+		IncidentEvent event = MakeEvent (IncidentEvent::STATS);
+		event.action = action;
+		event.incidentId = incidentId;
+		event.value[0] = nValidIncidents;
+		event.value[1] = m_reputationState->GetValidIncidents ();
+		event.value[2] = nInvalidIncidents;
+		event.value[3] = m_reputationState->GetInvalidIncidents ();
+		event.value[4] = reputation;
+		event.value[5] = m_reputationState->GetReputation ();
+		IncidentEventLog::Record (event);
+	}
+}
+
+void
+IncidentSink::ProcessBroadcast (const Address &from, uint32_t incidentId)
+{
+	NS_LOG_FUNCTION (this << from << incidentId);
+
+	if ( INCIDENT_EVENT_ENABLED (IncidentEvent::BRD_RCVD) )
+	{
+		IncidentEvent event = MakeEvent (IncidentEvent::BRD_RCVD);
+		event.dst = event.src;
+		event.src = InetSocketAddress::ConvertFrom (from).GetIpv4 ().Get ();
+		event.incidentId = incidentId;
+		IncidentEventLog::Record (event);
+	}
+
+	DoubleValue selfishProb = DoubleValue (.0);
+	bool shouldIConfirm = TossBiasedCoin(selfishProb.Get ());
+	if ( shouldIConfirm ) {
+		double delay = m_jitter->GetValue (0.1, 0.5);
+		if ( m_confirmationWindow.IsZero () || m_legacyConfirmationFormat ) {
+			Simulator::Schedule(Seconds (delay), &IncidentSink::SendConfirmation, this, from, incidentId);
+		}
+		else {
+			QueueConfirmation (from, incidentId, Seconds (delay));
 		}
 	}
+	//SendConfirmation (from, Seconds (0));
+
+	//NS_LOG_LOGIC ("Sending confirmation...");
+	//socket->SendTo(packet, 0, from);
+	//m_socketResp->Connect (from);
+	//m_socketResp->Send (Create<Packet> (512));
 }
 
+/*
+ * Same as IncidentGenerator::CacheLocalAddress.
+ */
 void
-IncidentSink::UpdateReputation (void)
+IncidentSink::CacheLocalAddress (void)
 {
-	DoubleValue nValidIncidents;
-	GetNode ()->GetAttribute ("ValidIncidents", nValidIncidents);
-	DoubleValue nInvalidIncidents;
-	GetNode ()->GetAttribute ("InvalidIncidents", nInvalidIncidents);
-
-	double newReputationVal = (nValidIncidents.Get () + 1) /
-			(nValidIncidents.Get () + nInvalidIncidents.Get () + 2);
-	GetNode()->SetAttribute ("Reputation", DoubleValue (newReputationVal));
-
-//	DoubleValue rep;
-//	GetNode()->GetAttribute ("Reputation", rep);
-//	NS_LOG_INFO ("Reputation value of Node " << GetNode()->GetId () <<
-//			" changed and the new value is " << rep.Get ());
+	if ( GetNode () == 0 ) return;	// Disposed
+
+	m_nodeId = GetNode ()->GetId ();
+	m_ipv4 = GetNode ()->GetObject<Ipv4> ();
+	m_local = m_ipv4->GetAddress (1, 0).GetLocal ();
+	NS_LOG_LOGIC ("Node " << m_nodeId << " local address " << m_local);
 }
 
-double
-IncidentSink::RandomNumberUniform ()
+IncidentEvent
+IncidentSink::MakeEvent (uint8_t kind)
 {
-	return rand () / double (RAND_MAX);
+	IncidentEvent event = IncidentEventLog::Make (kind, m_nodeId);
+	event.malicious = m_maliciousNode;
+	event.src = m_local.Get ();
+	return event;
 }
 
-double
-IncidentSink::RandomNumberInterval (double min, double max)
+void
+IncidentSink::UpdateReputation (void)
 {
-	return (max-min) * RandomNumberUniform () + min;
+	double nValidIncidents = m_reputationState->GetValidIncidents ();
+	double nInvalidIncidents = m_reputationState->GetInvalidIncidents ();
+
+	double newReputationVal = (nValidIncidents + 1) /
+			(nValidIncidents + nInvalidIncidents + 2);
+	m_reputationState->SetReputation (newReputationVal);
 }
 
 bool
 IncidentSink::TossBiasedCoin (double bias)
 {
-	double randomNumber = RandomNumberUniform ();
+	double randomNumber = m_coin->GetValue ();
 	bool accept = randomNumber < bias ? false : true;
 	return accept;
 }
@@ -26,12 +26,21 @@
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/nstime.h"
 
+#include <map>
+#include <vector>
 
 namespace ns3 {
 
 class Packet;
 class Socket;
+class ReputationState;
+class IncidentOracle;
+class Ipv4;
+struct IncidentEvent;
 
 class IncidentSink : public Application
 {
@@ -41,6 +50,39 @@ public:
 	IncidentSink ();
 	virtual ~IncidentSink ();
 
+	/**
+	 * Assign a fixed random variable stream number to the random variables
+	 * used by this application.
+	 *
+	 * \param stream first stream index to use
+	 * \return the number of stream indices assigned by this application
+	 */
+	int64_t AssignStreams (int64_t stream);
+
+	/**
+	 * Send our confirmations through 'oracle' instead of the sockets. Set
+	 * by IncidentOracle::Install.
+	 */
+	void SetOracle (Ptr<IncidentOracle> oracle);
+
+	/**
+	 * Handles the broadcast of incident 'incidentId' generated by 'from',
+	 * read from the socket or delivered by the oracle.
+	 */
+	void ProcessBroadcast (const Address &from, uint32_t incidentId);
+
+	/**
+	 * Handles a reputation update (0 to increase, 1 to decrease) sent by
+	 * 'from' for incident 'incidentId', which we confirmed.
+	 */
+	void ProcessReputationUpdate (const Address &from, uint8_t action, uint32_t incidentId);
+
+	/**
+	 * \returns the confirmations waiting for the end of their batching
+	 * window
+	 */
+	uint32_t GetNPendingConfirmations (void) const;
+
 protected:
 	virtual void DoDispose (void);
 
@@ -48,14 +90,17 @@ private:
 	virtual void StartApplication (void);
 	virtual void StopApplication (void);
 
-	void SendConfirmation (Address remote);
+	void SendConfirmation (Address remote, uint32_t incidentId);
+	void SendConfirmations (Address remote, const std::vector<uint32_t> &incidentIds);
+	void QueueConfirmation (const Address &remote, uint32_t incidentId, Time delay);
+	void FlushConfirmations (Address remote);
 
 	void HandleRead (Ptr<Socket> socket);
 
 	void UpdateReputation (void);
+	void CacheLocalAddress (void);
+	IncidentEvent MakeEvent (uint8_t kind);
 
-	double RandomNumberUniform ();
-	double RandomNumberInterval (double min, double max);
 	bool TossBiasedCoin (double bias);
 
 	uint16_t		m_port;
@@ -69,6 +114,23 @@ private:
 	double			m_confirmedIncWeight;
 
 	bool			m_maliciousNode;
+
+	bool			m_legacyConfirmationFormat;	// Send '#'-delimited text confirmations
+
+	Time			m_confirmationWindow;		// Batching window of the confirmations, 0 to send them one by one
+	std::map<Address, std::vector<uint32_t> >	m_pendingConfirmations;	// Incidents to confirm to every generator
+
+	ReputationState	*m_reputationState;		// Reputation state aggregated to our Node
+
+	Ptr<UniformRandomVariable>	m_coin;		// Decides whether a broadcast is confirmed
+	Ptr<UniformRandomVariable>	m_jitter;	// Delay before sending a confirmation
+
+	Ptr<IncidentOracle>	m_oracle;			// Delivers our confirmations when set
+
+	Ptr<Ipv4>	m_ipv4;			// Cached by CacheLocalAddress
+	Ipv4Address	m_local;		// Our address on interface 1
+	uint32_t	m_nodeId;
+	bool		m_linkChangeHooked;
 };
 
 } // namespace ns3
@@ -0,0 +1,281 @@
+/*
+ * incident-validator.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <map>
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/abort.h"
+
+#include "incident-validator.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("IncidentValidator");
+NS_OBJECT_ENSURE_REGISTERED(IncidentValidator);
+NS_OBJECT_ENSURE_REGISTERED(AbsoluteIncidentValidator);
+NS_OBJECT_ENSURE_REGISTERED(DensityIncidentValidator);
+NS_OBJECT_ENSURE_REGISTERED(WeightIncidentValidator);
+
+TypeId
+IncidentValidator::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::IncidentValidator")
+			.SetParent<Object> ()
+			.AddAttribute ("ConfirmationThreshold", "Incidents reaching it are valid.",
+					DoubleValue (1.),
+					MakeDoubleAccessor (&IncidentValidator::m_confirmationThreshold),
+					MakeDoubleChecker<double> ())
+			.AddAttribute ("DecreaseThreshold", "Incidents not above it are invalid.",
+					DoubleValue (1.),
+					MakeDoubleAccessor (&IncidentValidator::m_falseIncidentThreshold),
+					MakeDoubleChecker<double> ())
+	;
+
+	return tid;
+}
+
+IncidentValidator::IncidentValidator ()
+	: m_confirmationThreshold (1.),
+	  m_falseIncidentThreshold (1.)
+{
+}
+
+IncidentValidator::~IncidentValidator ()
+{
+}
+
+void
+IncidentValidator::Reset (State &state)
+{
+	state.answers = 0;
+	state.confirmations = 0;
+	state.nodes = 0;
+	state.weight = 0.;
+	state.aux[0] = 0.;
+	state.aux[1] = 0.;
+}
+
+bool
+IncidentValidator::IsFinal (const State &state, double ownReputation) const
+{
+	return false;
+}
+
+void
+IncidentValidator::GetStats (const State &state, double ownReputation, IncidentEvent &event) const
+{
+	event.action = CUSTOM_VALIDATION_MODE;
+	event.value[0] = m_confirmationThreshold;
+	event.value[1] = m_falseIncidentThreshold;
+	event.count = state.confirmations;
+	event.count2 = state.answers;
+}
+
+
+/***************************************************************
+ *           Absolute value
+ ***************************************************************/
+
+TypeId
+AbsoluteIncidentValidator::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::AbsoluteIncidentValidator")
+			.SetParent<IncidentValidator> ()
+			.AddConstructor<AbsoluteIncidentValidator> ()
+	;
+
+	return tid;
+}
+
+void
+AbsoluteIncidentValidator::GetStats (const State &state, double ownReputation, IncidentEvent &event) const
+{
+	event.action = ABSOLUTE_VALUE_MODE;
+	event.value[0] = (uint32_t) m_confirmationThreshold;
+	event.value[1] = (uint32_t) m_falseIncidentThreshold;
+	event.count = state.confirmations;
+	event.count2 = state.answers;
+}
+
+
+/***************************************************************
+ *           Density function
+ ***************************************************************/
+
+TypeId
+DensityIncidentValidator::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::DensityIncidentValidator")
+			.SetParent<IncidentValidator> ()
+			.AddConstructor<DensityIncidentValidator> ()
+	;
+
+	return tid;
+}
+
+void
+DensityIncidentValidator::GetStats (const State &state, double ownReputation, IncidentEvent &event) const
+{
+	event.action = DENSITY_FUNCTION_MODE;
+	event.value[0] = (uint32_t) ceil (state.answers * m_confirmationThreshold);
+	event.value[1] = (uint32_t) ceil (state.answers * m_falseIncidentThreshold);
+	event.count = state.confirmations;
+	event.count2 = state.answers;
+}
+
+
+/***************************************************************
+ *           Weight function
+ ***************************************************************/
+
+TypeId
+WeightIncidentValidator::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::WeightIncidentValidator")
+			.SetParent<IncidentValidator> ()
+			.AddConstructor<WeightIncidentValidator> ()
+			.AddAttribute ("WeightFunction", "The weight function to use (i.e. linear, exponential or table-based.",
+					UintegerValue (LINEAR_WEIGHT_FUN),
+					MakeUintegerAccessor (&WeightIncidentValidator::m_weightFunction),
+					MakeUintegerChecker<uint32_t> ())
+			.AddAttribute ("ReputationThreshold", "Minimum reputation value required.",
+					DoubleValue (0.9),
+					MakeDoubleAccessor (&WeightIncidentValidator::m_reputationThreshold),
+					MakeDoubleChecker<double> ())
+			.AddAttribute ("TableFile", "Points (reputation, weight) of the TABLE_WEIGHT_FUN weight function.",
+					StringValue (),
+					MakeStringAccessor (&WeightIncidentValidator::m_tableFile),
+					MakeStringChecker ())
+			.AddAttribute ("TableSize", "Intervals the reputations [0, 1] are sampled in.",
+					UintegerValue (1024),
+					MakeUintegerAccessor (&WeightIncidentValidator::m_tableSize),
+					MakeUintegerChecker<uint32_t> (1))
+	;
+
+	return tid;
+}
+
+WeightIncidentValidator::WeightIncidentValidator ()
+	: m_weightFunction (LINEAR_WEIGHT_FUN),
+	  m_reputationThreshold (0.9),
+	  m_tableSize (1024),
+	  m_earlyDecision (false)
+{
+}
+
+/*
+ * Weight tables built so far in this simulation, so that the validators
+ * each generator builds for itself do not compile (or read) the same
+ * function again. Emptied when the simulator is destroyed.
+ */
+struct WeightTableKey
+{
+	uint32_t	function;
+	double		reputationThreshold;	// Built-in functions only
+	std::string	file;					// TABLE_WEIGHT_FUN only
+	uint32_t	size;
+
+	bool operator < (const WeightTableKey &o) const
+	{
+		if ( function != o.function ) return function < o.function;
+		if ( reputationThreshold != o.reputationThreshold ) return reputationThreshold < o.reputationThreshold;
+		if ( size != o.size ) return size < o.size;
+		return file < o.file;
+	}
+};
+
+static std::map<WeightTableKey, Ptr<WeightFunctionTable> > g_weightTables;
+static bool g_clearScheduled = false;
+
+static void
+ClearWeightTables (void)
+{
+	g_weightTables.clear ();
+	g_clearScheduled = false;
+}
+
+/*
+ * \returns the table of 'key', built on first use, or 0 if it cannot be
+ * built
+ */
+static Ptr<WeightFunctionTable>
+GetWeightTable (const WeightTableKey &key)
+{
+	std::map<WeightTableKey, Ptr<WeightFunctionTable> >::const_iterator it = g_weightTables.find (key);
+	if ( it != g_weightTables.end () ) return it->second;
+
+	Ptr<WeightFunctionTable> table = Create<WeightFunctionTable> ();
+	bool ok = key.function == TABLE_WEIGHT_FUN ? table->Load (key.file, key.size)
+			: table->Compile (key.function, key.reputationThreshold, key.size);
+	if ( !ok ) return 0;
+
+	if ( !g_clearScheduled )
+	{
+		Simulator::ScheduleDestroy (&ClearWeightTables);
+		g_clearScheduled = true;
+	}
+	g_weightTables[key] = table;
+	return table;
+}
+
+void
+WeightIncidentValidator::DoStart (void)
+{
+	NS_LOG_FUNCTION (this);
+
+	WeightTableKey key;
+	key.function = m_weightFunction;
+	key.reputationThreshold = m_weightFunction == TABLE_WEIGHT_FUN ? 0. : m_reputationThreshold;
+	key.file = m_weightFunction == TABLE_WEIGHT_FUN ? m_tableFile : "";
+	key.size = m_tableSize;
+
+	m_table = GetWeightTable (key);
+	NS_ABORT_MSG_IF (m_table == 0 && m_weightFunction == TABLE_WEIGHT_FUN,
+			"WeightIncidentValidator: unable to load weight table '" << m_tableFile << "'");
+	NS_ABORT_MSG_IF (m_table == 0, "WeightIncidentValidator: unknown weight function " << m_weightFunction);
+	m_earlyDecision = m_table->GetMinimum () >= 0.;
+
+	IncidentValidator::DoStart ();
+}
+
+void
+WeightIncidentValidator::DoDispose (void)
+{
+	m_table = 0;
+	IncidentValidator::DoDispose ();
+}
+
+void
+WeightIncidentValidator::GetStats (const State &state, double ownReputation, IncidentEvent &event) const
+{
+	event.action = WEIGHT_FUNCTION_MODE;
+	event.value[0] = m_confirmationThreshold;
+	event.value[1] = m_falseIncidentThreshold;
+	event.value[2] = GetWeight (ownReputation) + state.weight;
+	event.count = state.nodes;
+	event.count2 = state.answers;
+}
+
+} // namespace ns3
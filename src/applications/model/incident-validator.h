@@ -0,0 +1,321 @@
+/*
+ * incident-validator.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef INCIDENT_VALIDATOR_H_
+#define INCIDENT_VALIDATOR_H_
+
+#include <stdint.h>
+#include <math.h>
+#include <string>
+
+#include "ns3/ptr.h"
+
+#include "ns3/object.h"
+
+#include "weight-function-table.h"
+#include "incident-event-log.h"
+
+#define ABSOLUTE_VALUE_MODE 0
+#define DENSITY_FUNCTION_MODE 1
+#define WEIGHT_FUNCTION_MODE 2
+#define CUSTOM_VALIDATION_MODE 3
+
+#define LINEAR_WEIGHT_FUN 21
+#define EXP_WEIGHT_FUN 22
+#define QUADRATIC_WEIGHT_FUN 23
+#define TABLE_WEIGHT_FUN 24
+
+#define INCREASE_REPUTATION 1
+#define DECREASE_REPUTATION -1
+#define DO_NOTHING 0
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Decides whether an incident was real from the confirmations it
+ * got.
+ *
+ * A validator holds the scheme and its thresholds; the progress of every
+ * incident lives in a State owned by the IncidentGenerator, so one
+ * validator serves all the incidents of a generator at once. Answers are
+ * streamed in with Add as they arrive and Decide is called when the
+ * confirmation window closes (or earlier, once IsFinal holds).
+ *
+ * New schemes derive from this class and register their own TypeId; the
+ * generator picks them up through its 'Validator' attribute. The built-in
+ * schemes are called without virtual dispatch (see IncidentValidatorAdd).
+ */
+class IncidentValidator : public Object
+{
+public:
+	/**
+	 * Progress of one incident.
+	 */
+	struct State
+	{
+		uint32_t	answers;		// Confirmations received, kept or not
+		uint32_t	confirmations;	// Confirmations kept
+		uint32_t	nodes;			// Distinct Nodes among the kept confirmations
+		double		weight;			// Weight of those Nodes (WeightIncidentValidator)
+		double		aux[2];			// Free for other schemes
+	};
+
+	/**
+	 * A confirmation, as seen by the generator.
+	 */
+	struct Answer
+	{
+		double		reputation;		// Of the confirming Node
+		double		selfishness;
+		bool		kept;			// The generator did not discard it
+		bool		firstFromNode;	// First kept confirmation of this Node for the incident
+	};
+
+	static TypeId GetTypeId (void);
+
+	IncidentValidator ();
+	virtual ~IncidentValidator ();
+
+	static void Reset (State &state);
+
+	/**
+	 * Accounts for 'answer'. The default only updates the counters.
+	 */
+	virtual void Add (State &state, const Answer &answer) const;
+
+	/**
+	 * \returns INCREASE_REPUTATION, DECREASE_REPUTATION or DO_NOTHING
+	 */
+	virtual int32_t Decide (const State &state, double ownReputation) const = 0;
+
+	/**
+	 * \returns true if no further answer can change the decision. The
+	 * default never decides early.
+	 */
+	virtual bool IsFinal (const State &state, double ownReputation) const;
+
+	/**
+	 * Fills the thresholds and counters of the decision into 'event', an
+	 * IncidentEvent::VALIDATION record: the validation mode in 'action',
+	 * the thresholds and the weight in 'value', the confirmations and the
+	 * answers in 'count' and 'count2'.
+	 */
+	virtual void GetStats (const State &state, double ownReputation, IncidentEvent &event) const;
+
+protected:
+	double		m_confirmationThreshold;
+	double		m_falseIncidentThreshold;
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief Valid with at least 'ConfirmationThreshold' confirmations, invalid
+ * with at most 'DecreaseThreshold' (ABSOLUTE_VALUE_MODE).
+ */
+class AbsoluteIncidentValidator : public IncidentValidator
+{
+public:
+	static TypeId GetTypeId (void);
+
+	inline virtual void Add (State &state, const Answer &answer) const;
+	inline virtual int32_t Decide (const State &state, double ownReputation) const;
+	inline virtual bool IsFinal (const State &state, double ownReputation) const;
+	virtual void GetStats (const State &state, double ownReputation, IncidentEvent &event) const;
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief Like AbsoluteIncidentValidator, with the thresholds given as a
+ * fraction of the answers received (DENSITY_FUNCTION_MODE).
+ *
+ * The number of answers can grow until the window closes, so it never
+ * decides early.
+ */
+class DensityIncidentValidator : public IncidentValidator
+{
+public:
+	static TypeId GetTypeId (void);
+
+	inline virtual void Add (State &state, const Answer &answer) const;
+	inline virtual int32_t Decide (const State &state, double ownReputation) const;
+	virtual void GetStats (const State &state, double ownReputation, IncidentEvent &event) const;
+};
+
+/**
+ * \ingroup applications
+ *
+ * \brief Adds the weight of the generator and of every confirming Node, a
+ * function of their reputation, and compares it with the thresholds
+ * (WEIGHT_FUNCTION_MODE).
+ *
+ * The weight function is compiled into a WeightFunctionTable when the
+ * validator is started (Object::Start), so weighing a confirmation is a
+ * table lookup. TABLE_WEIGHT_FUN reads the function from 'TableFile'.
+ * Validators with the same function share its table, which is built once
+ * per simulation.
+ *
+ * With a non-negative weight function, once the weight reaches
+ * 'ConfirmationThreshold' the decision is final. A function that can be
+ * negative (LINEAR_WEIGHT_FUN with a negative 'ReputationThreshold') never
+ * decides early.
+ */
+class WeightIncidentValidator : public IncidentValidator
+{
+public:
+	static TypeId GetTypeId (void);
+
+	WeightIncidentValidator ();
+
+	inline double GetWeight (double reputation) const;
+
+	inline virtual void Add (State &state, const Answer &answer) const;
+	inline virtual int32_t Decide (const State &state, double ownReputation) const;
+	inline virtual bool IsFinal (const State &state, double ownReputation) const;
+	virtual void GetStats (const State &state, double ownReputation, IncidentEvent &event) const;
+
+protected:
+	virtual void DoStart (void);
+	virtual void DoDispose (void);
+
+private:
+	uint32_t	m_weightFunction;
+	double		m_reputationThreshold;
+	std::string	m_tableFile;
+	uint32_t	m_tableSize;
+
+	Ptr<WeightFunctionTable>	m_table;
+	bool						m_earlyDecision;	// The weight function is non-negative
+};
+
+/**
+ * Calls V::Add without virtual dispatch. 'validator' must be exactly a V,
+ * not a type derived from it.
+ */
+template <class V>
+inline void
+IncidentValidatorAdd (const IncidentValidator &validator, IncidentValidator::State &state,
+		const IncidentValidator::Answer &answer)
+{
+	static_cast<const V &> (validator).V::Add (state, answer);
+}
+
+/**
+ * Calls V::Decide without virtual dispatch (see IncidentValidatorAdd).
+ */
+template <class V>
+inline int32_t
+IncidentValidatorDecide (const IncidentValidator &validator, const IncidentValidator::State &state,
+		double ownReputation)
+{
+	return static_cast<const V &> (validator).V::Decide (state, ownReputation);
+}
+
+/**
+ * Calls V::IsFinal without virtual dispatch (see IncidentValidatorAdd).
+ */
+template <class V>
+inline bool
+IncidentValidatorIsFinal (const IncidentValidator &validator, const IncidentValidator::State &state,
+		double ownReputation)
+{
+	return static_cast<const V &> (validator).V::IsFinal (state, ownReputation);
+}
+
+inline void
+IncidentValidator::Add (State &state, const Answer &answer) const
+{
+	++state.answers;
+	if ( answer.kept ) ++state.confirmations;
+	if ( answer.kept && answer.firstFromNode ) ++state.nodes;
+}
+
+void
+AbsoluteIncidentValidator::Add (State &state, const Answer &answer) const
+{
+	IncidentValidator::Add (state, answer);
+}
+
+int32_t
+AbsoluteIncidentValidator::Decide (const State &state, double ownReputation) const
+{
+	if ( state.confirmations >= (uint32_t) m_confirmationThreshold ) return INCREASE_REPUTATION;
+	else if ( state.confirmations <= (uint32_t) m_falseIncidentThreshold ) return DECREASE_REPUTATION;
+	return DO_NOTHING;
+}
+
+bool
+AbsoluteIncidentValidator::IsFinal (const State &state, double ownReputation) const
+{
+	return state.confirmations >= (uint32_t) m_confirmationThreshold;
+}
+
+void
+DensityIncidentValidator::Add (State &state, const Answer &answer) const
+{
+	IncidentValidator::Add (state, answer);
+}
+
+int32_t
+DensityIncidentValidator::Decide (const State &state, double ownReputation) const
+{
+	uint32_t requiredConfirmations = (uint32_t) ceil (state.answers * m_confirmationThreshold);
+	uint32_t minConfirmations = (uint32_t) ceil (state.answers * m_falseIncidentThreshold);
+	if ( state.confirmations >= requiredConfirmations ) return INCREASE_REPUTATION;
+	else if ( state.confirmations <= minConfirmations ) return DECREASE_REPUTATION;
+	return DO_NOTHING;
+}
+
+double
+WeightIncidentValidator::GetWeight (double reputation) const
+{
+	return m_table->Evaluate (reputation);
+}
+
+void
+WeightIncidentValidator::Add (State &state, const Answer &answer) const
+{
+	IncidentValidator::Add (state, answer);
+	if ( answer.kept && answer.firstFromNode ) state.weight += GetWeight (answer.reputation);
+}
+
+int32_t
+WeightIncidentValidator::Decide (const State &state, double ownReputation) const
+{
+	double weight = GetWeight (ownReputation) + state.weight;
+	if ( weight >= m_confirmationThreshold ) return INCREASE_REPUTATION;
+	else if ( weight <= m_falseIncidentThreshold ) return DECREASE_REPUTATION;
+	return DO_NOTHING;
+}
+
+bool
+WeightIncidentValidator::IsFinal (const State &state, double ownReputation) const
+{
+	return m_earlyDecision && GetWeight (ownReputation) + state.weight >= m_confirmationThreshold;
+}
+
+} // namespace ns3
+
+
+#endif /* INCIDENT_VALIDATOR_H_ */
@@ -0,0 +1,146 @@
+/*
+ * reputation-update-header.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include "ns3/log.h"
+
+#include "reputation-update-header.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ReputationUpdateHeader");
+NS_OBJECT_ENSURE_REGISTERED (ReputationUpdateHeader);
+
+ReputationUpdateHeader::ReputationUpdateHeader ()
+	: m_action (0),
+	  m_incidentId (0)
+{
+	NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+ReputationUpdateHeader::SetAction (uint8_t action)
+{
+	m_action = action;
+}
+
+uint8_t
+ReputationUpdateHeader::GetAction (void) const
+{
+	return m_action;
+}
+
+void
+ReputationUpdateHeader::SetIncidentId (uint32_t incidentId)
+{
+	m_incidentId = incidentId;
+}
+
+uint32_t
+ReputationUpdateHeader::GetIncidentId (void) const
+{
+	return m_incidentId;
+}
+
+void
+ReputationUpdateHeader::AddAddress (Ipv4Address address)
+{
+	m_addresses.push_back (address);
+}
+
+uint32_t
+ReputationUpdateHeader::GetNAddresses (void) const
+{
+	return m_addresses.size ();
+}
+
+Ipv4Address
+ReputationUpdateHeader::GetAddress (uint32_t i) const
+{
+	return m_addresses[i];
+}
+
+bool
+ReputationUpdateHeader::Contains (Ipv4Address address) const
+{
+	for ( uint32_t i = 0; i < m_addresses.size (); i++ )
+	{
+		if ( m_addresses[i] == address ) return true;
+	}
+	return false;
+}
+
+TypeId
+ReputationUpdateHeader::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::ReputationUpdateHeader")
+			.SetParent<Header> ()
+			.AddConstructor<ReputationUpdateHeader> ()
+	;
+	return tid;
+}
+
+TypeId
+ReputationUpdateHeader::GetInstanceTypeId (void) const
+{
+	return GetTypeId ();
+}
+
+void
+ReputationUpdateHeader::Print (std::ostream &os) const
+{
+	os << "(a=" << (uint32_t) m_action << " id=" << m_incidentId << " n=" << m_addresses.size () << ")";
+}
+
+uint32_t
+ReputationUpdateHeader::GetSerializedSize (void) const
+{
+	return 1 + 4 + 2 + 4 * m_addresses.size ();
+}
+
+void
+ReputationUpdateHeader::Serialize (Buffer::Iterator start) const
+{
+	Buffer::Iterator i = start;
+	i.WriteU8 (m_action);
+	i.WriteHtonU32 (m_incidentId);
+	i.WriteHtonU16 (m_addresses.size ());
+	for ( uint32_t n = 0; n < m_addresses.size (); n++ )
+	{
+		i.WriteHtonU32 (m_addresses[n].Get ());
+	}
+}
+
+uint32_t
+ReputationUpdateHeader::Deserialize (Buffer::Iterator start)
+{
+	Buffer::Iterator i = start;
+	m_action = i.ReadU8 ();
+	m_incidentId = i.ReadNtohU32 ();
+	uint16_t count = i.ReadNtohU16 ();
+	m_addresses.resize (count);
+	for ( uint32_t n = 0; n < count; n++ )
+	{
+		m_addresses[n] = Ipv4Address (i.ReadNtohU32 ());
+	}
+	return GetSerializedSize ();
+}
+
+} // namespace ns3
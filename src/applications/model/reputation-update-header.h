@@ -0,0 +1,79 @@
+/*
+ * reputation-update-header.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef REPUTATION_UPDATE_HEADER_H_
+#define REPUTATION_UPDATE_HEADER_H_
+
+#include <vector>
+
+#include "ns3/header.h"
+#include "ns3/ipv4-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief Reputation update broadcast by an IncidentGenerator to all the
+ * Nodes that confirmed an incident at once.
+ *
+ * Carries the action (0 to increase the reputation, 1 to decrease it), the
+ * id of the validated incident and the addresses of the confirming Nodes; a
+ * sink only applies a broadcast update if its own address is listed.
+ * Unicast updates carry no addresses.
+ */
+class ReputationUpdateHeader : public Header
+{
+public:
+	ReputationUpdateHeader ();
+
+	void SetAction (uint8_t action);
+	uint8_t GetAction (void) const;
+
+	void SetIncidentId (uint32_t incidentId);
+	uint32_t GetIncidentId (void) const;
+
+	void AddAddress (Ipv4Address address);
+	uint32_t GetNAddresses (void) const;
+	Ipv4Address GetAddress (uint32_t i) const;
+
+	/**
+	 * \returns true if 'address' is one of the listed Nodes
+	 */
+	bool Contains (Ipv4Address address) const;
+
+	static TypeId GetTypeId (void);
+	virtual TypeId GetInstanceTypeId (void) const;
+	virtual void Print (std::ostream &os) const;
+	virtual uint32_t GetSerializedSize (void) const;
+	virtual void Serialize (Buffer::Iterator start) const;
+	virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+	uint8_t						m_action;
+	uint32_t					m_incidentId;
+	std::vector<Ipv4Address>	m_addresses;	// Nodes the update applies to
+};
+
+} // namespace ns3
+
+
+#endif /* REPUTATION_UPDATE_HEADER_H_ */
@@ -0,0 +1,292 @@
+/*
+ * spatial-grid-index.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/node.h"
+#include "ns3/mobility-model.h"
+
+#include "spatial-grid-index.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("SpatialGridIndex");
+NS_OBJECT_ENSURE_REGISTERED(SpatialGridIndex);
+
+TypeId
+SpatialGridIndex::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::SpatialGridIndex")
+			.SetParent<Object> ()
+			.AddConstructor<SpatialGridIndex> ()
+			.AddAttribute ("CellSize", "Side of the grid cells, in meters (usually the wifi range).",
+					DoubleValue (100.),
+					MakeDoubleAccessor (&SpatialGridIndex::m_cellSize),
+					MakeDoubleChecker<double> (0.))
+			.AddAttribute ("MaxSpeed", "Highest speed of any node, in m/s. If 0, the highest current speed "
+					"of the nodes is used.",
+					DoubleValue (0.),
+					MakeDoubleAccessor (&SpatialGridIndex::m_maxSpeed),
+					MakeDoubleChecker<double> (0.))
+	;
+
+	return tid;
+}
+
+SpatialGridIndex::SpatialGridIndex ()
+	: m_cellSize (100.),
+	  m_maxSpeed (0.),
+	  m_built (false),
+	  m_cell (100.),
+	  m_minX (0.),
+	  m_minY (0.),
+	  m_nx (1),
+	  m_ny (1)
+{
+}
+
+SpatialGridIndex::~SpatialGridIndex ()
+{
+}
+
+void
+SpatialGridIndex::DoDispose (void)
+{
+	for ( uint32_t i = 0; i < m_entries.size (); i++ )
+	{
+		m_mobility[i]->TraceDisconnectWithoutContext ("CourseChange",
+				MakeBoundCallback (&SpatialGridIndex::CourseChanged, &m_entries[i]));
+	}
+	m_entries.clear ();
+	m_mobility.clear ();
+	m_cells.clear ();
+	m_speedOf.clear ();
+	m_speeds.clear ();
+	m_nodes = NodeContainer ();
+	Object::DoDispose ();
+}
+
+void
+SpatialGridIndex::Install (NodeContainer nodes)
+{
+	NS_ASSERT_MSG (m_entries.empty (), "SpatialGridIndex: already installed");
+
+	m_nodes = nodes;
+	m_mobility.resize (nodes.GetN ());
+	m_entries.resize (nodes.GetN ());
+	m_cellOf.resize (nodes.GetN ());
+	m_slotOf.resize (nodes.GetN ());
+	m_speedOf.resize (nodes.GetN ());
+	m_speeds.clear ();
+
+	for ( uint32_t i = 0; i < nodes.GetN (); i++ )
+	{
+		Ptr<MobilityModel> mobility = nodes.Get (i)->GetObject<MobilityModel> ();
+		NS_ASSERT_MSG (mobility != 0, "SpatialGridIndex: Node " << i << " has no MobilityModel");
+
+		m_mobility[i] = PeekPointer (mobility);
+		Vector velocity = mobility->GetVelocity ();
+		m_speedOf[i] = std::sqrt (velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z);
+		m_speeds.insert (m_speedOf[i]);
+		m_entries[i].index = this;
+		m_entries[i].node = i;
+		mobility->TraceConnectWithoutContext ("CourseChange",
+				MakeBoundCallback (&SpatialGridIndex::CourseChanged, &m_entries[i]));
+	}
+
+	m_built = false;
+}
+
+uint32_t
+SpatialGridIndex::GetN (void) const
+{
+	return m_mobility.size ();
+}
+
+Vector
+SpatialGridIndex::GetPosition (uint32_t index) const
+{
+	return m_mobility[index]->GetPosition ();
+}
+
+void
+SpatialGridIndex::GetNodesInRange (uint32_t index, double range, std::vector<uint32_t> &nodes)
+{
+	Query (m_mobility[index]->GetPosition (), range, index, nodes);
+}
+
+void
+SpatialGridIndex::GetNodesInRange (const Vector &position, double range, std::vector<uint32_t> &nodes)
+{
+	Query (position, range, m_mobility.size (), nodes);
+}
+
+void
+SpatialGridIndex::Query (const Vector &position, double range, uint32_t exclude, std::vector<uint32_t> &nodes)
+{
+	nodes.clear ();
+	if ( m_mobility.empty () ) return;
+
+	double speed = GetSpeedBound ();
+	double elapsed = (Simulator::Now () - m_builtAt).GetSeconds ();
+	if ( !m_built || speed * elapsed > m_cell / 2 )
+	{
+		Rebuild ();
+		elapsed = 0;
+	}
+
+	// Nodes may have moved away from their cell since the last rebuild
+	double reach = range + speed * elapsed;
+	double x0 = std::max (0., std::floor ((position.x - reach - m_minX) / m_cell));
+	double x1 = std::min (m_nx - 1., std::floor ((position.x + reach - m_minX) / m_cell));
+	double y0 = std::max (0., std::floor ((position.y - reach - m_minY) / m_cell));
+	double y1 = std::min (m_ny - 1., std::floor ((position.y + reach - m_minY) / m_cell));
+	if ( x0 > x1 || y0 > y1 ) return;
+
+	double range2 = range * range;
+	for ( uint32_t cy = (uint32_t) y0; cy <= (uint32_t) y1; cy++ )
+	{
+		for ( uint32_t cx = (uint32_t) x0; cx <= (uint32_t) x1; cx++ )
+		{
+			const std::vector<uint32_t> &cell = m_cells[cy * m_nx + cx];
+			for ( uint32_t k = 0; k < cell.size (); k++ )
+			{
+				uint32_t node = cell[k];
+				if ( node == exclude ) continue;
+
+				Vector other = m_mobility[node]->GetPosition ();
+				double dx = other.x - position.x;
+				double dy = other.y - position.y;
+				double dz = other.z - position.z;
+				if ( dx * dx + dy * dy + dz * dz <= range2 ) nodes.push_back (node);
+			}
+		}
+	}
+}
+
+void
+SpatialGridIndex::Rebuild (void)
+{
+	uint32_t n = m_mobility.size ();
+
+	double minX = 0, maxX = 0, minY = 0, maxY = 0;
+	for ( uint32_t i = 0; i < n; i++ )
+	{
+		Vector position = m_mobility[i]->GetPosition ();
+		if ( i == 0 || position.x < minX ) minX = position.x;
+		if ( i == 0 || position.x > maxX ) maxX = position.x;
+		if ( i == 0 || position.y < minY ) minY = position.y;
+		if ( i == 0 || position.y > maxY ) maxY = position.y;
+	}
+
+	// Keep the number of cells in the order of the number of nodes
+	m_cell = std::max (m_cellSize, 1e-3);
+	double maxCells = std::max (1024., 4. * n);
+	while ( ((maxX - minX) / m_cell + 1) * ((maxY - minY) / m_cell + 1) > maxCells ) m_cell *= 2;
+
+	m_minX = minX;
+	m_minY = minY;
+	m_nx = (uint32_t) ((maxX - minX) / m_cell) + 1;
+	m_ny = (uint32_t) ((maxY - minY) / m_cell) + 1;
+
+	// Clear the cells in place to keep their capacity
+	for ( uint32_t c = 0; c < m_cells.size (); c++ ) m_cells[c].clear ();
+	m_cells.resize (m_nx * m_ny);
+
+	for ( uint32_t i = 0; i < n; i++ )
+	{
+		Insert (i, GetCell (m_mobility[i]->GetPosition ()));
+	}
+
+	m_built = true;
+	m_builtAt = Simulator::Now ();
+	NS_LOG_LOGIC ("Rebuilt " << m_nx << "x" << m_ny << " grid of " << m_cell << "m cells");
+}
+
+/*
+ * Every node moves in a straight line at its current speed since it was put
+ * in its cell (at the last rebuild or at its last course change), so the
+ * highest current speed bounds how far any of them is from its cell.
+ */
+double
+SpatialGridIndex::GetSpeedBound (void) const
+{
+	if ( m_maxSpeed > 0 || m_speeds.empty () ) return m_maxSpeed;
+	return *m_speeds.rbegin ();
+}
+
+uint32_t
+SpatialGridIndex::GetCell (const Vector &position) const
+{
+	double cx = std::min (m_nx - 1., std::max (0., std::floor ((position.x - m_minX) / m_cell)));
+	double cy = std::min (m_ny - 1., std::max (0., std::floor ((position.y - m_minY) / m_cell)));
+	return (uint32_t) cy * m_nx + (uint32_t) cx;
+}
+
+void
+SpatialGridIndex::Insert (uint32_t node, uint32_t cell)
+{
+	m_cellOf[node] = cell;
+	m_slotOf[node] = m_cells[cell].size ();
+	m_cells[cell].push_back (node);
+}
+
+void
+SpatialGridIndex::Remove (uint32_t node)
+{
+	std::vector<uint32_t> &cell = m_cells[m_cellOf[node]];
+	uint32_t slot = m_slotOf[node];
+	uint32_t last = cell.back ();
+
+	cell[slot] = last;
+	m_slotOf[last] = slot;
+	cell.pop_back ();
+}
+
+void
+SpatialGridIndex::CourseChanged (Entry *entry, Ptr<const MobilityModel> model)
+{
+	SpatialGridIndex *index = entry->index;
+
+	Vector velocity = model->GetVelocity ();
+	double speed = std::sqrt (velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z);
+	double &oldSpeed = index->m_speedOf[entry->node];
+	if ( speed != oldSpeed )
+	{
+		index->m_speeds.erase (index->m_speeds.find (oldSpeed));
+		index->m_speeds.insert (speed);
+		oldSpeed = speed;
+	}
+
+	if ( !index->m_built ) return;
+
+	uint32_t cell = index->GetCell (model->GetPosition ());
+	if ( cell == index->m_cellOf[entry->node] ) return;
+
+	index->Remove (entry->node);
+	index->Insert (entry->node, cell);
+}
+
+} // namespace ns3
@@ -0,0 +1,134 @@
+/*
+ * spatial-grid-index.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef SPATIAL_GRID_INDEX_H_
+#define SPATIAL_GRID_INDEX_H_
+
+#include <stdint.h>
+#include <set>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/node-container.h"
+
+namespace ns3 {
+
+class MobilityModel;
+
+/**
+ * \ingroup applications
+ *
+ * \brief Uniform grid over the positions of a set of nodes.
+ *
+ * Nodes are bucketed in square cells of 'CellSize' meters (usually the
+ * wifi range), so the nodes within range of a point are found by looking
+ * at the few cells around it instead of at every node.
+ *
+ * Positions change continuously, so the grid is rebuilt lazily at query
+ * time: a node can be at most v * (now - last rebuild) away from the cell
+ * it was put in, and queries widen their search by that much. Once that
+ * slack exceeds half a cell the grid is rebuilt. v is MaxSpeed if set;
+ * otherwise it is the highest current speed of the nodes, which the grid
+ * follows through their CourseChange traces. A node that changes course is
+ * moved to its current cell at once, so its speed before does not count.
+ *
+ * Query results are exact: candidates are checked against their current
+ * position.
+ */
+class SpatialGridIndex : public Object
+{
+public:
+	static TypeId GetTypeId (void);
+
+	SpatialGridIndex ();
+	virtual ~SpatialGridIndex ();
+
+	/**
+	 * Indexes 'nodes', which must all have a MobilityModel. Node indexes
+	 * below refer to this container.
+	 */
+	void Install (NodeContainer nodes);
+
+	uint32_t GetN (void) const;
+
+	/**
+	 * \returns the current position of node 'index'
+	 */
+	Vector GetPosition (uint32_t index) const;
+
+	/**
+	 * Fills 'nodes' with the nodes within 'range' meters of node 'index',
+	 * not including itself.
+	 */
+	void GetNodesInRange (uint32_t index, double range, std::vector<uint32_t> &nodes);
+
+	/**
+	 * Fills 'nodes' with the nodes within 'range' meters of 'position'.
+	 */
+	void GetNodesInRange (const Vector &position, double range, std::vector<uint32_t> &nodes);
+
+protected:
+	virtual void DoDispose (void);
+
+private:
+	struct Entry
+	{
+		SpatialGridIndex	*index;
+		uint32_t			node;
+	};
+
+	static void CourseChanged (Entry *entry, Ptr<const MobilityModel> model);
+
+	void Query (const Vector &position, double range, uint32_t exclude, std::vector<uint32_t> &nodes);
+	void Rebuild (void);
+	uint32_t GetCell (const Vector &position) const;
+	void Insert (uint32_t node, uint32_t cell);
+	void Remove (uint32_t node);
+	double GetSpeedBound (void) const;
+
+	double		m_cellSize;
+	double		m_maxSpeed;			// m/s, 0 to follow the nodes
+
+	NodeContainer					m_nodes;
+	std::vector<MobilityModel *>	m_mobility;
+	std::vector<Entry>				m_entries;		// Bound to the CourseChange callbacks
+
+	bool		m_built;
+	Time		m_builtAt;
+	double		m_cell;				// Cell size in use, never below m_cellSize
+	double		m_minX;				// Grid origin and size, in cells
+	double		m_minY;
+	uint32_t	m_nx;
+	uint32_t	m_ny;
+
+	std::vector<std::vector<uint32_t> >	m_cells;
+	std::vector<uint32_t>				m_cellOf;	// Cell of every node
+	std::vector<uint32_t>				m_slotOf;	// Position of every node in its cell
+	std::vector<double>					m_speedOf;	// Current speed of every node
+	std::multiset<double>				m_speeds;	// The same, sorted
+};
+
+} // namespace ns3
+
+
+#endif /* SPATIAL_GRID_INDEX_H_ */
@@ -0,0 +1,146 @@
+/*
+ * weight-function-table.cc
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <math.h>
+
+#include "ns3/log.h"
+
+#include "weight-function-table.h"
+#include "incident-validator.h"
+
+NS_LOG_COMPONENT_DEFINE ("WeightFunctionTable");
+
+namespace ns3 {
+
+WeightFunctionTable::WeightFunctionTable ()
+	: m_scale (0.),
+	  m_last (0)
+{
+}
+
+bool
+WeightFunctionTable::Compile (uint32_t function, double reputationThreshold, uint32_t size)
+{
+	NS_ASSERT (size > 0);
+
+	m_samples.resize (size + 1);
+	for ( uint32_t i = 0; i <= size; i++ )
+	{
+		double reputation = (double) i / size;
+		switch ( function )
+		{
+		case LINEAR_WEIGHT_FUN:
+			m_samples[i] = reputation / reputationThreshold;
+			break;
+
+		case EXP_WEIGHT_FUN:
+			m_samples[i] = exp (4 * (reputation - reputationThreshold));
+			break;
+
+		case QUADRATIC_WEIGHT_FUN:
+			m_samples[i] = reputation * reputation;
+			break;
+
+		default:
+			m_samples.clear ();
+			return false;
+		}
+	}
+
+	m_scale = size;
+	m_last = size;
+	return true;
+}
+
+bool
+WeightFunctionTable::Load (std::string file, uint32_t size)
+{
+	NS_ASSERT (size > 0);
+
+	std::ifstream in (file.c_str ());
+	if ( !in.is_open () )
+	{
+		NS_LOG_ERROR ("Unable to open weight table " << file);
+		return false;
+	}
+
+	std::vector<std::pair<double, double> > points;
+	std::string line;
+	while ( std::getline (in, line) )
+	{
+		std::string::size_type first = line.find_first_not_of (" \t\r");
+		if ( first == std::string::npos || line[first] == '#' ) continue;
+
+		std::istringstream parse (line);
+		double reputation, weight;
+		if ( !(parse >> reputation >> weight) )
+		{
+			NS_LOG_ERROR ("Malformed weight table " << file << ": '" << line << "'");
+			return false;
+		}
+		if ( !(reputation >= 0. && reputation <= 1.) || !(weight >= 0.) )
+		{
+			NS_LOG_ERROR ("Invalid point in weight table " << file << ": '" << line
+					<< "' (reputations must be in [0, 1], weights non-negative)");
+			return false;
+		}
+		points.push_back (std::make_pair (reputation, weight));
+	}
+	if ( points.empty () )
+	{
+		NS_LOG_ERROR ("Empty weight table " << file);
+		return false;
+	}
+	std::sort (points.begin (), points.end ());
+
+	m_samples.resize (size + 1);
+	uint32_t next = 0;		// First point above the current sample
+	for ( uint32_t i = 0; i <= size; i++ )
+	{
+		double reputation = (double) i / size;
+		while ( next < points.size () && points[next].first <= reputation ) next++;
+
+		if ( next == 0 ) m_samples[i] = points.front ().second;
+		else if ( next == points.size () ) m_samples[i] = points.back ().second;
+		else
+		{
+			const std::pair<double, double> &a = points[next - 1];
+			const std::pair<double, double> &b = points[next];
+			m_samples[i] = a.second + (reputation - a.first) * (b.second - a.second) / (b.first - a.first);
+		}
+	}
+
+	m_scale = size;
+	m_last = size;
+	return true;
+}
+
+double
+WeightFunctionTable::GetMinimum (void) const
+{
+	NS_ASSERT_MSG (!m_samples.empty (), "WeightFunctionTable: not compiled");
+	return *std::min_element (m_samples.begin (), m_samples.end ());
+}
+
+} // namespace ns3
@@ -0,0 +1,100 @@
+/*
+ * weight-function-table.h
+ * Copyright (C) 2012  Cristian Tanas
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Author: Cristian Tanas <ctanas@deic.uab.cat>
+ */
+
+#ifndef WEIGHT_FUNCTION_TABLE_H_
+#define WEIGHT_FUNCTION_TABLE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ns3/assert.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * \brief A weight function over the reputations [0, 1], sampled into a
+ * dense table.
+ *
+ * The table holds 'size' + 1 evenly spaced samples and is linearly
+ * interpolated between them, so evaluating any function costs two loads
+ * and a multiply-add. It is compiled from one of the built-in weight
+ * functions (LINEAR_WEIGHT_FUN, EXP_WEIGHT_FUN, QUADRATIC_WEIGHT_FUN) or
+ * loaded from a file of (reputation, weight) points (TABLE_WEIGHT_FUN).
+ * Reputations outside [0, 1] are clamped.
+ *
+ * Tables are reference counted so that validators with the same function
+ * can share one.
+ */
+class WeightFunctionTable : public SimpleRefCount<WeightFunctionTable>
+{
+public:
+	WeightFunctionTable ();
+
+	/**
+	 * Samples built-in weight function 'function' for reputation threshold
+	 * 'reputationThreshold'. Returns false if 'function' is unknown.
+	 */
+	bool Compile (uint32_t function, double reputationThreshold, uint32_t size);
+
+	/**
+	 * Samples the piecewise linear function through the points of 'file'.
+	 * Every line holds a reputation and its weight, separated by blanks;
+	 * lines starting with '#' are ignored. The function is constant beyond
+	 * the first and last points. Returns false unless every reputation is
+	 * in [0, 1] and every weight is non-negative.
+	 */
+	bool Load (std::string file, uint32_t size);
+
+	inline double Evaluate (double reputation) const;
+
+	/**
+	 * \returns the smallest weight of the function
+	 */
+	double GetMinimum (void) const;
+
+private:
+	std::vector<double>	m_samples;
+	double				m_scale;		// Samples per unit of reputation
+	uint32_t			m_last;			// Index of the last sample
+};
+
+double
+WeightFunctionTable::Evaluate (double reputation) const
+{
+	NS_ASSERT_MSG (!m_samples.empty (), "WeightFunctionTable: not compiled");
+
+	double x = reputation * m_scale;
+	if ( !(x > 0.) ) return m_samples[0];	// Also catches NaN
+	uint32_t i = (uint32_t) x;
+	if ( i >= m_last ) return m_samples[m_last];
+
+	double frac = x - i;
+	return m_samples[i] + frac * (m_samples[i + 1] - m_samples[i]);
+}
+
+} // namespace ns3
+
+
+#endif /* WEIGHT_FUNCTION_TABLE_H_ */
@@ -34,13 +34,87 @@
 #include "ns3/boolean.h"
 #include "ns3/simulator.h"
 #include "ns3/double.h"
+#include "ns3/trace-source-accessor.h"
 
 NS_LOG_COMPONENT_DEFINE ("Node");
 
 namespace ns3 {
 
+NS_OBJECT_ENSURE_REGISTERED (ReputationState);
 NS_OBJECT_ENSURE_REGISTERED (Node);
 
+TypeId
+ReputationState::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ReputationState")
+    .SetParent<Object> ()
+    .AddConstructor<ReputationState> ()
+    .AddAttribute ("Reputation", "The reputation value for this Node.",
+    			   DoubleValue (0.1),
+    			   MakeDoubleAccessor (&ReputationState::m_reputationVal),
+    			   MakeDoubleChecker<double> ())
+    .AddAttribute ("SelfishProb", "The probability of the Node being selfish",
+    			   DoubleValue (0.0),
+    			   MakeDoubleAccessor (&ReputationState::m_selfishness),
+    			   MakeDoubleChecker<double> ())
+    .AddAttribute ("ValidIncidents", "The number of valid incident reports of this Node.",
+    			   DoubleValue (0.),
+    			   MakeDoubleAccessor (&ReputationState::m_NValidIncidents),
+    			   MakeDoubleChecker<double> ())
+    .AddAttribute ("InvalidIncidents", "The number of invalid incident reports of this Node.",
+    			   DoubleValue (0.),
+       			   MakeDoubleAccessor (&ReputationState::m_NInvalidIncidents),
+       			   MakeDoubleChecker<double> ())
+    .AddTraceSource ("Reputation", "The Node's reputation value",
+    			   MakeTraceSourceAccessor (&ReputationState::m_reputationVal))
+  ;
+  return tid;
+}
+
+ReputationState::ReputationState ()
+  : m_reputationVal (0.1),
+    m_selfishness (0.),
+    m_NValidIncidents (0.),
+    m_NInvalidIncidents (0.)
+{
+}
+
+ReputationState::~ReputationState ()
+{
+}
+
+/**
+ * Forwards the "Reputation" trace source of a Node to its aggregated
+ * ReputationState, so that "/NodeList/x/Reputation" paths keep working.
+ */
+class NodeReputationTraceAccessor : public TraceSourceAccessor
+{
+public:
+  virtual bool ConnectWithoutContext (ObjectBase *obj, const CallbackBase &cb) const
+  {
+    return GetState (obj)->TraceConnectWithoutContext ("Reputation", cb);
+  }
+  virtual bool Connect (ObjectBase *obj, std::string context, const CallbackBase &cb) const
+  {
+    return GetState (obj)->TraceConnect ("Reputation", context, cb);
+  }
+  virtual bool DisconnectWithoutContext (ObjectBase *obj, const CallbackBase &cb) const
+  {
+    return GetState (obj)->TraceDisconnectWithoutContext ("Reputation", cb);
+  }
+  virtual bool Disconnect (ObjectBase *obj, std::string context, const CallbackBase &cb) const
+  {
+    return GetState (obj)->TraceDisconnect ("Reputation", context, cb);
+  }
+private:
+  static Ptr<ReputationState> GetState (ObjectBase *obj)
+  {
+    Node *node = dynamic_cast<Node *> (obj);
+    NS_ASSERT (node != 0);
+    return node->GetReputationState ();
+  }
+};
+
 GlobalValue g_checksumEnabled  = GlobalValue ("ChecksumEnabled",
                                               "A global switch to enable all checksums for all protocols",
                                               BooleanValue (false),
@@ -67,36 +141,38 @@ Node::GetTypeId (void)
                    MakeUintegerChecker<uint32_t> ())
     .AddAttribute ("Reputation", "The reputation value for this Node.",
     			   DoubleValue (0.1),
-    			   MakeDoubleAccessor (&Node::m_reputationVal),
+    			   MakeDoubleAccessor (&Node::SetReputation, &Node::GetReputation),
     			   MakeDoubleChecker<double> ())
     .AddAttribute ("SelfishProb", "The probability of the Node being selfish",
     			   DoubleValue (0.0),
-    			   MakeDoubleAccessor (&Node::m_selfishness),
+    			   MakeDoubleAccessor (&Node::SetSelfishness, &Node::GetSelfishness),
     			   MakeDoubleChecker<double> ())
     .AddAttribute ("ValidIncidents", "The number of valid incident reports of this Node.",
     			   DoubleValue (0.),
-    			   MakeDoubleAccessor (&Node::m_NValidIncidents),
+    			   MakeDoubleAccessor (&Node::SetValidIncidents, &Node::GetValidIncidents),
     			   MakeDoubleChecker<double> ())
     .AddAttribute ("InvalidIncidents", "The number of invalid incident reports of this Node.",
     			   DoubleValue (0.),
-       			   MakeDoubleAccessor (&Node::m_NInvalidIncidents),
+       			   MakeDoubleAccessor (&Node::SetInvalidIncidents, &Node::GetInvalidIncidents),
        			   MakeDoubleChecker<double> ())
     .AddTraceSource ("Reputation", "The Node's reputation value",
-    			   MakeTraceSourceAccessor (&Node::m_reputationVal))
+    			   Ptr<const TraceSourceAccessor> (Create<NodeReputationTraceAccessor> ()))
   ;
   return tid;
 }
 
 Node::Node()
   : m_id (0),
-    m_sid (0)
+    m_sid (0),
+    m_reputationState (0)
 {
   Construct ();
 }
 
 Node::Node(uint32_t sid)
   : m_id (0),
-    m_sid (sid)
+    m_sid (sid),
+    m_reputationState (0)
 { 
   Construct ();
 }
@@ -105,6 +181,12 @@ void
 Node::Construct (void)
 {
   m_id = NodeList::Add (this);
+
+  // The state has to exist before our own attributes are constructed,
+  // since the reputation attributes of Node are forwarded to it.
+  Ptr<ReputationState> state = CreateObject<ReputationState> ();
+  AggregateObject (state);
+  m_reputationState = PeekPointer (state);
 }
 
 Node::~Node ()
@@ -123,6 +205,60 @@ Node::GetSystemId (void) const
   return m_sid;
 }
 
+Ptr<ReputationState>
+Node::GetReputationState (void) const
+{
+  return m_reputationState;
+}
+
+double
+Node::GetReputation (void) const
+{
+  return m_reputationState->GetReputation ();
+}
+
+void
+Node::SetReputation (double reputation)
+{
+  m_reputationState->SetReputation (reputation);
+}
+
+double
+Node::GetSelfishness (void) const
+{
+  return m_reputationState->GetSelfishness ();
+}
+
+void
+Node::SetSelfishness (double selfishness)
+{
+  m_reputationState->SetSelfishness (selfishness);
+}
+
+double
+Node::GetValidIncidents (void) const
+{
+  return m_reputationState->GetValidIncidents ();
+}
+
+void
+Node::SetValidIncidents (double validIncidents)
+{
+  m_reputationState->SetValidIncidents (validIncidents);
+}
+
+double
+Node::GetInvalidIncidents (void) const
+{
+  return m_reputationState->GetInvalidIncidents ();
+}
+
+void
+Node::SetInvalidIncidents (double invalidIncidents)
+{
+  m_reputationState->SetInvalidIncidents (invalidIncidents);
+}
+
 uint32_t
 Node::AddDevice (Ptr<NetDevice> device)
 {
@@ -37,6 +37,44 @@ class Application;
 class Packet;
 class Address;
 
+/**
+ * \ingroup network
+ *
+ * \brief Reputation state of a Node in the Incidencies scenarios.
+ *
+ * One ReputationState is aggregated to every Node when it is created.
+ * Applications on the hot path keep a raw pointer to it and use the inline
+ * accessors below; the "Reputation", "SelfishProb", "ValidIncidents" and
+ * "InvalidIncidents" attributes of Node (and its "Reputation" trace source)
+ * are forwarded to this object so that configuration scripts keep working.
+ */
+class ReputationState : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  ReputationState ();
+  virtual ~ReputationState ();
+
+  double GetReputation (void) const { return m_reputationVal.Get (); }
+  void SetReputation (double reputation) { m_reputationVal = reputation; }
+
+  double GetSelfishness (void) const { return m_selfishness; }
+  void SetSelfishness (double selfishness) { m_selfishness = selfishness; }
+
+  double GetValidIncidents (void) const { return m_NValidIncidents; }
+  void SetValidIncidents (double validIncidents) { m_NValidIncidents = validIncidents; }
+
+  double GetInvalidIncidents (void) const { return m_NInvalidIncidents; }
+  void SetInvalidIncidents (double invalidIncidents) { m_NInvalidIncidents = invalidIncidents; }
+
+private:
+  TracedValue<double>	  	m_reputationVal;		// Reputation value of the node
+  double					m_selfishness;			// Selfish probability for the Node
+  double					m_NValidIncidents;		// Validated incidents for the Node
+  double					m_NInvalidIncidents;	// Invalid incidents reported by the Node
+};
+
 
 /**
  * \ingroup network
@@ -197,6 +235,11 @@ public:
 
 
 
+  /**
+   * \returns the ReputationState aggregated to this Node.
+   */
+  Ptr<ReputationState> GetReputationState (void) const;
+
   /**
    * \returns true if checksums are enabled, false otherwise.
    */
@@ -221,6 +264,16 @@ private:
 
   void Construct (void);
 
+  // Attribute wrappers around the aggregated ReputationState
+  double GetReputation (void) const;
+  void SetReputation (double reputation);
+  double GetSelfishness (void) const;
+  void SetSelfishness (double selfishness);
+  double GetValidIncidents (void) const;
+  void SetValidIncidents (double validIncidents);
+  double GetInvalidIncidents (void) const;
+  void SetInvalidIncidents (double invalidIncidents);
+
   struct ProtocolHandlerEntry {
     ProtocolHandler handler;
     Ptr<NetDevice> device;
@@ -237,10 +290,7 @@ private:
   ProtocolHandlerList m_handlers;
   DeviceAdditionListenerList m_deviceAdditionListeners;
 
-  TracedValue<double>	  	m_reputationVal;		// Reputation value of the node
-  double					m_selfishness;			// Selfish probability for the Node
-  double					m_NValidIncidents;		// Validated incidents for the Node
-  double					m_NInvalidIncidents;	// Invalid incidents reported by the Node
+  ReputationState *m_reputationState;	// Aggregated to this Node, not owned
 };
 
 } // namespace ns3